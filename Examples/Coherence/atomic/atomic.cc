@@ -78,16 +78,19 @@ int main(int argc, char **argv)
   {
     TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<top_level_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(INC_TASK_ID, "inc_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<inc_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<sum_task>(registrar);
   }
   return Runtime::start(argc, argv);
@@ -0,0 +1,8 @@
+//
+// The task trace sources of Mapping/trace, compiled into this example by its Makefile.
+// The Legion makefile puts each object file next to its source, so the example builds
+// its own copy through this file rather than sharing objects in Mapping/trace with
+// other examples built with other flags.
+//
+#include "../../Mapping/trace/task_trace.cc"
+#include "../../Mapping/trace/trace_mapper.cc"
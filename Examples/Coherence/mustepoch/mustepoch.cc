@@ -0,0 +1,262 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  PRODUCER_TASK_ID,
+  CONSUMER_TASK_ID,
+  PERSISTENT_PRODUCER_TASK_ID,
+  PERSISTENT_CONSUMER_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// The barriers passed to the persistent tasks: full is arrived at by the producer when
+// the buffer holds a new value, empty by the consumer when it has read the value
+struct PipelineArgs {
+  PhaseBarrier full;
+  PhaseBarrier empty;
+  int iterations;
+};
+
+//
+// The pipeline of Coherence/simultaneous/sim.cc: every iteration launches a producer
+// and a consumer, ordered by acquires and releases waiting on phase barriers.
+//
+double run_relaunch(Context ctx, Runtime *rt, LogicalRegion lr, int iterations)
+{
+  PhaseBarrier odd = rt->create_phase_barrier(ctx,1);
+  PhaseBarrier even = rt->create_phase_barrier(ctx,1);
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < iterations; i++) {
+    PhaseBarrier odd_next = rt->advance_phase_barrier(ctx,odd);
+    PhaseBarrier even_next = rt->advance_phase_barrier(ctx,even);
+
+    AcquireLauncher al_producer(lr,lr);
+    al_producer.add_field(FIELD_A);
+    if (i > 0)
+      al_producer.add_wait_barrier(odd_next);
+    rt->issue_acquire(ctx,al_producer);
+
+    TaskLauncher producer_launcher(PRODUCER_TASK_ID, TaskArgument(&i,sizeof(int)));
+    producer_launcher.add_region_requirement(RegionRequirement(lr, WRITE_DISCARD, SIMULTANEOUS, lr));
+    producer_launcher.add_field(0,FIELD_A);
+    rt->execute_task(ctx, producer_launcher);
+
+    ReleaseLauncher rl_producer(lr,lr);
+    rl_producer.add_field(FIELD_A);
+    rl_producer.add_arrival_barrier(even);
+    rt->issue_release(ctx,rl_producer);
+
+    AcquireLauncher al_consumer(lr,lr);
+    al_consumer.add_field(FIELD_A);
+    al_consumer.add_wait_barrier(even_next);
+    rt->issue_acquire(ctx,al_consumer);
+
+    TaskLauncher consumer_launcher(CONSUMER_TASK_ID, TaskArgument(&i,sizeof(int)));
+    consumer_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, SIMULTANEOUS, lr));
+    consumer_launcher.add_field(0,FIELD_A);
+    rt->execute_task(ctx, consumer_launcher);
+
+    ReleaseLauncher rl_consumer(lr,lr);
+    rl_consumer.add_field(FIELD_A);
+    rl_consumer.add_arrival_barrier(odd);
+    rt->issue_release(ctx,rl_consumer);
+
+    odd = odd_next;
+    even = even_next;
+  }
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double stop = Realm::Clock::current_time_in_microseconds();
+  rt->destroy_phase_barrier(ctx,odd);
+  rt->destroy_phase_barrier(ctx,even);
+  return stop - start;
+}
+
+//
+// Launch one producer and one consumer in a must-epoch launch, which guarantees that
+// they run at the same time and share the same instance of the region.  Each task
+// loops over all the iterations itself, and the handoff of every value is just an
+// arrival on and a wait for a phase barrier inside the tasks.
+//
+double run_persistent(Context ctx, Runtime *rt, LogicalRegion lr, int iterations)
+{
+  PipelineArgs args;
+  args.full = rt->create_phase_barrier(ctx,1);
+  args.empty = rt->create_phase_barrier(ctx,1);
+  args.iterations = iterations;
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double start = Realm::Clock::current_time_in_microseconds();
+
+  MustEpochLauncher must_epoch_launcher;
+  TaskLauncher producer_launcher(PERSISTENT_PRODUCER_TASK_ID, TaskArgument(&args,sizeof(args)));
+  producer_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, SIMULTANEOUS, lr));
+  producer_launcher.add_field(0,FIELD_A);
+  must_epoch_launcher.add_single_task(DomainPoint(0), producer_launcher);
+  TaskLauncher consumer_launcher(PERSISTENT_CONSUMER_TASK_ID, TaskArgument(&args,sizeof(args)));
+  consumer_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, SIMULTANEOUS, lr));
+  consumer_launcher.add_field(0,FIELD_A);
+  must_epoch_launcher.add_single_task(DomainPoint(1), consumer_launcher);
+  rt->execute_must_epoch(ctx, must_epoch_launcher).wait_all_results();
+
+  const double stop = Realm::Clock::current_time_in_microseconds();
+  rt->destroy_phase_barrier(ctx,args.full);
+  rt->destroy_phase_barrier(ctx,args.empty);
+  return stop - start;
+}
+
+//
+// Compares the latency of one producer-to-consumer handoff when the tasks are
+// relaunched every iteration and when they are persistent.  The two persistent tasks
+// must run on different processors, so run with at least three CPUs (-ll:cpu 3),
+// one of which is taken by the top-level task.
+//
+//  Command line options:
+//    -iterations N   number of values passed from the producer to the consumer
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int iterations = 1000;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-iterations") && (i+1) < command_args.argc)
+        iterations = atoi(command_args.argv[++i]);
+    }
+
+  Rect<1> rec(Point<1>(0),Point<1>(99));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+  int init = -1;
+  rt->fill_field(ctx,lr,lr,fida,&init,sizeof(init));
+
+  const double relaunch_us = run_relaunch(ctx, rt, lr, iterations);
+  const double persistent_us = run_persistent(ctx, rt, lr, iterations);
+  printf("relaunch:   %10.3f us per iteration\n", relaunch_us / iterations);
+  printf("persistent: %10.3f us per iteration\n", persistent_us / iterations);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+void write_value(Context ctx, Runtime *rt, const Task *task, const PhysicalRegion &pr, int value)
+{
+  const FieldAccessor<READ_WRITE,int,1> fa_a(pr, FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = value;
+    }
+}
+
+void check_value(Context ctx, Runtime *rt, const Task *task, const PhysicalRegion &pr, int value)
+{
+  const FieldAccessor<READ_WRITE,int,1> fa_a(pr, FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      assert(fa_a[*itr] == value);
+      fa_a[*itr] = 0;
+    }
+}
+
+void producer_task(const Task *task,
+		   const std::vector<PhysicalRegion> &rgns,
+		   Context ctx, Runtime *rt)
+{
+  write_value(ctx, rt, task, rgns[0], *((const int *) task->args));
+}
+
+void consumer_task(const Task *task,
+		   const std::vector<PhysicalRegion> &rgns,
+		   Context ctx, Runtime *rt)
+{
+  check_value(ctx, rt, task, rgns[0], *((const int *) task->args));
+}
+
+void persistent_producer_task(const Task *task,
+			      const std::vector<PhysicalRegion> &rgns,
+			      Context ctx, Runtime *rt)
+{
+  const PipelineArgs &args = *((const PipelineArgs *) task->args);
+  PhaseBarrier full = args.full;
+  PhaseBarrier empty = args.empty;
+  for (int i = 0; i < args.iterations; i++)
+    {
+      // Wait for the consumer to finish with the previous value
+      if (i > 0)
+        {
+          empty.wait();
+          empty = rt->advance_phase_barrier(ctx, empty);
+        }
+      write_value(ctx, rt, task, rgns[0], i);
+      full.arrive();
+      full = rt->advance_phase_barrier(ctx, full);
+    }
+}
+
+void persistent_consumer_task(const Task *task,
+			      const std::vector<PhysicalRegion> &rgns,
+			      Context ctx, Runtime *rt)
+{
+  const PipelineArgs &args = *((const PipelineArgs *) task->args);
+  PhaseBarrier full = args.full;
+  PhaseBarrier empty = args.empty;
+  for (int i = 0; i < args.iterations; i++)
+    {
+      full.wait();
+      full = rt->advance_phase_barrier(ctx, full);
+      check_value(ctx, rt, task, rgns[0], i);
+      empty.arrive();
+      empty = rt->advance_phase_barrier(ctx, empty);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PRODUCER_TASK_ID, "producer_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<producer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CONSUMER_TASK_ID, "consumer_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<consumer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PERSISTENT_PRODUCER_TASK_ID, "persistent_producer_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<persistent_producer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PERSISTENT_CONSUMER_TASK_ID, "persistent_consumer_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<persistent_consumer_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
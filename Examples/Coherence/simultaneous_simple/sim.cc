@@ -97,16 +97,19 @@ int main(int argc, char **argv)
   {
     TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<top_level_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(PRODUCER_TASK_ID, "producer_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<producer_task>(registrar, "producer_task");
   }
   {
     TaskVariantRegistrar registrar(CONSUMER_TASK_ID, "consumer_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<consumer_task>(registrar, "consumer_task");
   }  
   return Runtime::start(argc, argv);
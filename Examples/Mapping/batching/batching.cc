@@ -0,0 +1,383 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  PRODUCER_ID,
+  CONSUMER_ID,
+  SIM_PRODUCER_ID,
+  SIM_CONSUMER_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// The priority is kept above the low bits of the tag, which the default mapper
+// reads as its own flags (bit 0 is SAME_ADDRESS_SPACE)
+static const int PRIORITY_SHIFT = 16;
+
+MappingTagID priority_tag(int priority)
+{
+  return ((MappingTagID)priority) << PRIORITY_SHIFT;
+}
+
+//
+// A mapper that batches ready tasks in select_tasks_to_map and maps them in order
+// of an estimate of their distance to the end of the critical path, rather than in
+// the order they became ready.  The estimate of a task is
+//
+//     weight[task_id] + priority
+//
+// where the per-task-ID weights are supplied when the mapper is created (a task on
+// the critical path gets a larger weight than a task that only consumes a result)
+// and the priority is chosen by the application, for example the number of steps
+// remaining on a dependency chain, and passed in a launch tag made by priority_tag.
+// The same estimate is used as the task priority in map_task, so the processor also
+// runs critical tasks first.
+//
+// Command line options:
+//   -batch:fifo       map ready tasks in arrival order (the usual behavior)
+//   -batch:window N   maximum number of tasks mapped per select_tasks_to_map call
+//
+class BatchingMapper : public DefaultMapper {
+public:
+  BatchingMapper(MapperRuntime *rt, Machine m, Processor p,
+                 const std::map<TaskID,int> &weights);
+public:
+  virtual void select_tasks_to_map(const MapperContext ctx,
+                                   const SelectMappingInput &input,
+                                   SelectMappingOutput &output);
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+public:
+  static void register_batching_mappers(Machine machine, Runtime *rt,
+                                        const std::set<Processor> &local_procs);
+protected:
+  int critical_path_estimate(const Task *task) const;
+protected:
+  // Sorts tasks with the longest estimated remaining path first, breaking
+  // ties in favor of the oldest task
+  struct CriticalPathOrder {
+    CriticalPathOrder(const BatchingMapper *m) : mapper(m) { }
+    bool operator()(const Task *a, const Task *b) const
+    {
+      const int ea = mapper->critical_path_estimate(a);
+      const int eb = mapper->critical_path_estimate(b);
+      if (ea != eb)
+        return (ea > eb);
+      return (a->get_unique_id() < b->get_unique_id());
+    }
+    const BatchingMapper *mapper;
+  };
+protected:
+  const std::map<TaskID,int> weights;
+  bool fifo;
+  unsigned window;
+};
+
+BatchingMapper::BatchingMapper(MapperRuntime *rt, Machine m, Processor p,
+                               const std::map<TaskID,int> &w)
+  : DefaultMapper(rt, m, p, "batching_mapper"), weights(w), fifo(false), window(16)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-batch:fifo"))
+        fifo = true;
+      else if (!strcmp(command_args.argv[i], "-batch:window") && (i+1) < command_args.argc)
+        window = atoi(command_args.argv[++i]);
+    }
+  assert(window > 0);
+}
+
+int BatchingMapper::critical_path_estimate(const Task *task) const
+{
+  int estimate = (int)(task->tag >> PRIORITY_SHIFT);
+  std::map<TaskID,int>::const_iterator finder = weights.find((TaskID)task->task_id);
+  if (finder != weights.end())
+    estimate += finder->second;
+  return estimate;
+}
+
+void BatchingMapper::select_tasks_to_map(const MapperContext ctx,
+                                         const SelectMappingInput &input,
+                                         SelectMappingOutput &output)
+{
+  std::vector<const Task*> batch(input.ready_tasks.begin(), input.ready_tasks.end());
+  if (!fifo)
+    std::stable_sort(batch.begin(), batch.end(), CriticalPathOrder(this));
+  unsigned count = 0;
+  for (std::vector<const Task*>::const_iterator it = batch.begin();
+       (count < window) && (it != batch.end()); it++)
+    {
+      // Tasks that are headed elsewhere are sent on without using up the window
+      if ((*it)->target_proc != local_proc)
+        output.relocate_tasks[*it] = (*it)->target_proc;
+      else
+        {
+          output.map_tasks.insert(*it);
+          count++;
+        }
+    }
+}
+
+void BatchingMapper::map_task(const MapperContext ctx,
+                              const Task &task,
+                              const MapTaskInput &input,
+                              MapTaskOutput &output)
+{
+  DefaultMapper::map_task(ctx, task, input, output);
+  if (!fifo)
+    output.task_priority = critical_path_estimate(&task);
+}
+
+static std::map<TaskID,int> task_weights;
+
+/*static*/
+void BatchingMapper::register_batching_mappers(Machine machine, Runtime *rt,
+                                               const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new BatchingMapper(map_rt, machine, *it, task_weights), *it);
+    }
+}
+
+// Spin for a while to give a task some weight; volatile keeps the loop alive
+void spin(int iterations)
+{
+  volatile int work = 0;
+  for (int w = 0; w < iterations; w++)
+    work = work + 1;
+}
+
+//
+// A chain of producers, each of which waits for the value of the previous one, with a
+// consumer hanging off every link.  The producers form the critical path; the consumers
+// can run at any time after their producer.  Each producer is tagged with the number of
+// links that remain after it.
+//
+void run_chain(Context ctx, Runtime *runtime, int length, int work)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  Future previous;
+  for (int i = 0; i < length; i++) {
+    TaskLauncher producer_launcher(PRODUCER_ID, TaskArgument(&work,sizeof(int)));
+    if (i > 0)
+      producer_launcher.add_future(previous);
+    producer_launcher.tag = priority_tag(length - i);
+    previous = runtime->execute_task(ctx,producer_launcher);
+    TaskLauncher consumer_launcher(CONSUMER_ID, TaskArgument(&work,sizeof(int)));
+    consumer_launcher.add_future(previous);
+    runtime->execute_task(ctx,consumer_launcher);
+  }
+  int last = previous.get_result<int>();
+  assert(last == length);
+  const double chain_done = Realm::Clock::current_time_in_microseconds();
+  runtime->issue_execution_fence(ctx).get_void_result();
+  const double stop = Realm::Clock::current_time_in_microseconds();
+  printf("Chain of %d: last producer after %.3f ms, all tasks after %.3f ms\n",
+         length, (chain_done - start) * 1e-3, (stop - start) * 1e-3);
+}
+
+//
+// The producer/consumer loop of Coherence/simultaneous/sim.cc: both tasks share a region
+// with simultaneous coherence and hand it back and forth with acquire/release and phase
+// barriers.  Producers are tagged with the number of iterations remaining.
+//
+void run_simultaneous(Context ctx, Runtime *rt, int iterations, int work)
+{
+  Rect<1> rec(Point<1>(0),Point<1>(99));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+
+  PhaseBarrier odd = rt->create_phase_barrier(ctx,1);
+  PhaseBarrier even = rt->create_phase_barrier(ctx,1);
+
+  const double start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < iterations; i++) {
+    PhaseBarrier odd_next = rt->advance_phase_barrier(ctx,odd);
+    PhaseBarrier even_next = rt->advance_phase_barrier(ctx,even);
+    int args[2] = { i, work };
+
+    AcquireLauncher al_producer(lr,lr);
+    al_producer.add_field(FIELD_A);
+    if (i > 0)
+      al_producer.add_wait_barrier(odd_next);
+    rt->issue_acquire(ctx,al_producer);
+
+    TaskLauncher producer_launcher(SIM_PRODUCER_ID, TaskArgument(args,sizeof(args)));
+    producer_launcher.add_region_requirement(RegionRequirement(lr, WRITE_DISCARD, SIMULTANEOUS, lr));
+    producer_launcher.add_field(0,FIELD_A);
+    producer_launcher.tag = priority_tag(iterations - i);
+    rt->execute_task(ctx, producer_launcher);
+
+    ReleaseLauncher rl_producer(lr,lr);
+    rl_producer.add_field(FIELD_A);
+    rl_producer.add_arrival_barrier(even);
+    rt->issue_release(ctx,rl_producer);
+
+    AcquireLauncher al_consumer(lr,lr);
+    al_consumer.add_field(FIELD_A);
+    al_consumer.add_wait_barrier(even_next);
+    rt->issue_acquire(ctx,al_consumer);
+
+    TaskLauncher consumer_launcher(SIM_CONSUMER_ID, TaskArgument(args,sizeof(args)));
+    consumer_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, SIMULTANEOUS, lr));
+    consumer_launcher.add_field(0,FIELD_A);
+    rt->execute_task(ctx, consumer_launcher);
+
+    ReleaseLauncher rl_consumer(lr,lr);
+    rl_consumer.add_field(FIELD_A);
+    rl_consumer.add_arrival_barrier(odd);
+    rt->issue_release(ctx,rl_consumer);
+
+    odd = odd_next;
+    even = even_next;
+  }
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double stop = Realm::Clock::current_time_in_microseconds();
+  printf("Simultaneous pipeline of %d iterations: %.3f ms\n", iterations, (stop - start) * 1e-3);
+
+  rt->destroy_phase_barrier(ctx,odd);
+  rt->destroy_phase_barrier(ctx,even);
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+//
+//  Command line options:
+//    -length N   number of links in the producer chain and iterations of the pipeline
+//    -work N     spin iterations in every task
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  int length = 100;
+  int work = 100000;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-length") && (i+1) < command_args.argc)
+        length = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-work") && (i+1) < command_args.argc)
+        work = atoi(command_args.argv[++i]);
+    }
+  run_chain(ctx, runtime, length, work);
+  run_simultaneous(ctx, runtime, length, work);
+}
+
+int producer_task(const Task *task,
+		  const std::vector<PhysicalRegion> &regions,
+		  Context ctx,
+		  Runtime *runtime)
+{
+  spin(*((const int *) task->args));
+  // The first producer of the chain has no predecessor
+  if (task->futures.empty())
+    return 1;
+  return task->futures[0].get_result<int>() + 1;
+}
+
+void consumer_task(const Task *task,
+		   const std::vector<PhysicalRegion> &regions,
+		   Context ctx,
+		   Runtime *runtime)
+{
+  spin(*((const int *) task->args));
+  int value = task->futures[0].get_result<int>();
+  assert(value > 0);
+}
+
+void sim_producer_task(const Task *task,
+		       const std::vector<PhysicalRegion> &rgns,
+		       Context ctx, Runtime *rt)
+{
+  const int *args = (const int *) task->args;
+  spin(args[1]);
+  const FieldAccessor<READ_WRITE,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = args[0];
+    }
+}
+
+void sim_consumer_task(const Task *task,
+		       const std::vector<PhysicalRegion> &rgns,
+		       Context ctx, Runtime *rt)
+{
+  const int *args = (const int *) task->args;
+  spin(args[1]);
+  const FieldAccessor<READ_WRITE,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      assert(fa_a[*itr] == args[0]);
+      fa_a[*itr] = 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PRODUCER_ID, "producer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<int,producer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CONSUMER_ID, "consumer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<consumer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SIM_PRODUCER_ID, "sim_producer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<sim_producer_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SIM_CONSUMER_ID, "sim_consumer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<sim_consumer_task>(registrar);
+  }
+  // Producers lie on the critical path of both workloads, consumers do not
+  task_weights[PRODUCER_ID] = 1;
+  task_weights[CONSUMER_ID] = 0;
+  task_weights[SIM_PRODUCER_ID] = 1;
+  task_weights[SIM_CONSUMER_ID] = 0;
+  Runtime::add_registration_callback(BatchingMapper::register_batching_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,267 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  SUM_TASK_ID,
+  INC_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+enum TraceIDs {
+  INC_LOOP_TRACE_ID,
+};
+
+//
+// A mapper that supports physical tracing.  Memoizing the mapping of a task lets the
+// runtime record the whole analysis of a traced loop the first time through and replay
+// it on later iterations, but only if the mapper makes the same decisions every time
+// the task is mapped.  This mapper requests memoization for every task and remembers
+// the result of map_task for each combination of task ID and region tree shape (the
+// regions, fields and privileges named by the region requirements), so a task that
+// is mapped again gets exactly the same variant, processors and instances.
+//
+// Command line options:
+//   -memo:off   do not memoize and do not cache mappings
+//
+class MemoizingMapper : public DefaultMapper {
+public:
+  MemoizingMapper(MapperRuntime *rt, Machine m, Processor p);
+public:
+  virtual void select_task_options(const MapperContext ctx,
+                                   const Task &task,
+                                   TaskOptions &output);
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+public:
+  static void register_memoizing_mappers(Machine machine, Runtime *rt,
+                                         const std::set<Processor> &local_procs);
+protected:
+  typedef std::vector<unsigned long long> MappingKey;
+  struct CachedMapping {
+    VariantID chosen_variant;
+    std::vector<Processor> target_procs;
+    std::vector<std::vector<PhysicalInstance> > chosen_instances;
+  };
+  static void compute_mapping_key(const Task &task, MappingKey &key);
+protected:
+  bool memoize;
+  std::map<MappingKey,CachedMapping> mapping_cache;
+};
+
+MemoizingMapper::MemoizingMapper(MapperRuntime *rt, Machine m, Processor p)
+  : DefaultMapper(rt, m, p, "memoizing_mapper"), memoize(true)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-memo:off"))
+        memoize = false;
+    }
+}
+
+void MemoizingMapper::select_task_options(const MapperContext ctx,
+                                          const Task &task,
+                                          TaskOptions &output)
+{
+  DefaultMapper::select_task_options(ctx, task, output);
+  output.memoize = memoize;
+}
+
+/*static*/
+void MemoizingMapper::compute_mapping_key(const Task &task, MappingKey &key)
+{
+  key.push_back(task.task_id);
+  for (unsigned idx = 0; idx < task.regions.size(); idx++)
+    {
+      const RegionRequirement &req = task.regions[idx];
+      key.push_back(req.region.get_tree_id());
+      key.push_back(req.region.get_index_space().get_id());
+      key.push_back(req.region.get_field_space().get_id());
+      key.push_back(req.privilege);
+      key.push_back(req.prop);
+      for (std::set<FieldID>::const_iterator it = req.privilege_fields.begin();
+           it != req.privilege_fields.end(); it++)
+        key.push_back(*it);
+    }
+}
+
+void MemoizingMapper::map_task(const MapperContext ctx,
+                               const Task &task,
+                               const MapTaskInput &input,
+                               MapTaskOutput &output)
+{
+  if (!memoize)
+    {
+      DefaultMapper::map_task(ctx, task, input, output);
+      return;
+    }
+  MappingKey key;
+  compute_mapping_key(task, key);
+  std::map<MappingKey,CachedMapping>::const_iterator finder = mapping_cache.find(key);
+  if (finder != mapping_cache.end())
+    {
+      // Reuse the cached instances if they have not been collected in the meantime
+      std::vector<std::vector<PhysicalInstance> > instances = finder->second.chosen_instances;
+      if (runtime->acquire_and_filter_instances(ctx, instances))
+        {
+          output.chosen_variant = finder->second.chosen_variant;
+          output.target_procs = finder->second.target_procs;
+          output.chosen_instances = instances;
+          return;
+        }
+      mapping_cache.erase(key);
+    }
+  DefaultMapper::map_task(ctx, task, input, output);
+  CachedMapping &cached = mapping_cache[key];
+  cached.chosen_variant = output.chosen_variant;
+  cached.target_procs = output.target_procs;
+  cached.chosen_instances = output.chosen_instances;
+}
+
+/*static*/
+void MemoizingMapper::register_memoizing_mappers(Machine machine, Runtime *rt,
+                                                 const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new MemoizingMapper(map_rt, machine, *it), *it);
+    }
+}
+
+//
+// The loop of Regions/atomic/atomic.cc, repeated for several iterations with each
+// iteration captured in a trace.  The first iteration records the trace and the
+// following iterations replay it.
+//
+// Command line options:
+//   -iterations N   number of traced iterations
+//   -tasks N        number of increment tasks per iteration
+//   -notrace        run the same loop without tracing
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int iterations = 20;
+  int tasks = 10;
+  bool trace = true;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-iterations") && (i+1) < command_args.argc)
+        iterations = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-tasks") && (i+1) < command_args.argc)
+        tasks = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-notrace"))
+        trace = false;
+    }
+
+  Rect<1> rec(Point<1>(0),Point<1>(99));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+
+  int init = 1;
+  rt->fill_field(ctx,lr,lr,fida,&init,sizeof(init));
+
+  TaskLauncher inc_launcher(INC_TASK_ID, TaskArgument(NULL,0));
+  inc_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, ATOMIC, lr));
+  inc_launcher.add_field(0,FIELD_A);
+
+  for (int iter = 0; iter < iterations; iter++) {
+    const double start = Realm::Clock::current_time_in_microseconds();
+    if (trace)
+      rt->begin_trace(ctx, INC_LOOP_TRACE_ID);
+    for (int i = 0; i < tasks; i++)
+      rt->execute_task(ctx, inc_launcher);
+    if (trace)
+      rt->end_trace(ctx, INC_LOOP_TRACE_ID);
+    rt->issue_execution_fence(ctx).get_void_result();
+    const double stop = Realm::Clock::current_time_in_microseconds();
+    printf("Iteration %d: %.3f us per task\n", iter, (stop - start) / tasks);
+  }
+
+  int expected = init + iterations * tasks;
+  TaskLauncher sum_launcher(SUM_TASK_ID, TaskArgument(&expected,sizeof(expected)));
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0,FIELD_A);
+  rt->execute_task(ctx, sum_launcher);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+void inc_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_WRITE,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = fa_a[*itr] + 1;
+    }
+}
+
+void sum_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  int expected = *((const int *) task->args);
+  const FieldAccessor<READ_ONLY,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  int sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      assert(fa_a[*itr] == expected);
+      sum += fa_a[*itr];
+    }
+  printf("The sum of the elements of the region is %d\n",sum);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INC_TASK_ID, "inc_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<inc_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<sum_task>(registrar);
+  }
+  Runtime::add_registration_callback(MemoizingMapper::register_memoizing_mappers);
+
+  return Runtime::start(argc, argv);
+}
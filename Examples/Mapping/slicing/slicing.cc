@@ -0,0 +1,288 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <algorithm>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  POINT_TASK_ID,
+};
+
+//
+// A mapper that slices index launches hierarchically.  The first call to slice_task
+// splits the launch domain into one block per address space and sends each block to
+// a leader processor in that address space.  Each leader splits its block into one
+// block per NUMA domain of its address space and sends those to a leader processor of
+// each NUMA domain, which finally splits its block across the processors of its NUMA
+// domain.  No mapper ever produces more slices than there are address spaces, NUMA
+// domains in an address space, or processors in a NUMA domain, and the work of
+// slicing is spread over the machine instead of falling on the launching processor.
+//
+// Because the blocks are computed deterministically from the launch domain, a mapper
+// can tell which level it is at by comparing the domain it is given with the blocks
+// of the levels above it.
+//
+// Command line options:
+//   -slice:default   use the default mapper's slice_task instead
+//
+class SlicingMapper : public DefaultMapper {
+public:
+  SlicingMapper(MapperRuntime *rt, Machine m, Processor p);
+public:
+  virtual void slice_task(const MapperContext ctx,
+                          const Task &task,
+                          const SliceTaskInput &input,
+                          SliceTaskOutput &output);
+public:
+  static void register_slicing_mappers(Machine machine, Runtime *rt,
+                                       const std::set<Processor> &local_procs);
+protected:
+  // Split a dense domain into at most the given number of blocks along its longest dimension
+  static void split_domain(const Domain &domain, size_t pieces, std::vector<Domain> &blocks);
+  template<int DIM>
+  static void split_rect(const Rect<DIM> &rect, size_t pieces, std::vector<Domain> &blocks);
+  static bool is_block_of(const Domain &domain, const Domain &parent, size_t pieces);
+protected:
+  bool use_default;
+  // The processor of our kind with the smallest ID in each address space
+  std::vector<Processor> space_leaders;
+  // The processor of our kind with the smallest ID in each NUMA domain of our address space
+  std::vector<Processor> numa_leaders;
+  // The processors of our kind in our NUMA domain
+  std::vector<Processor> numa_procs;
+};
+
+SlicingMapper::SlicingMapper(MapperRuntime *rt, Machine m, Processor p)
+  : DefaultMapper(rt, m, p, "slicing_mapper"), use_default(false)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-slice:default"))
+        use_default = true;
+    }
+
+  // The leader of an address space is its processor with the smallest ID, so
+  // every mapper agrees on who the leaders are
+  std::map<AddressSpace,Processor> leaders;
+  Machine::ProcessorQuery all_procs(m);
+  all_procs.only_kind(p.kind());
+  for (Machine::ProcessorQuery::iterator it = all_procs.begin();
+       it != all_procs.end(); it++)
+    {
+      std::map<AddressSpace,Processor>::iterator finder = leaders.find(it->address_space());
+      if (finder == leaders.end())
+        leaders[it->address_space()] = *it;
+      else if ((*it) < finder->second)
+        finder->second = *it;
+    }
+  for (std::map<AddressSpace,Processor>::const_iterator it = leaders.begin();
+       it != leaders.end(); it++)
+    space_leaders.push_back(it->second);
+
+  // Group the processors of our address space by the socket memory they have affinity
+  // to.  Without NUMA support there are no socket memories and every processor of the
+  // address space is in a single domain.
+  std::map<Memory,std::vector<Processor> > domains;
+  Machine::ProcessorQuery local_procs(m);
+  local_procs.local_address_space();
+  local_procs.only_kind(p.kind());
+  for (Machine::ProcessorQuery::iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      Machine::MemoryQuery numa_query(m);
+      numa_query.only_kind(Memory::SOCKET_MEM);
+      numa_query.has_affinity_to(*it);
+      domains[numa_query.first()].push_back(*it);
+    }
+  for (std::map<Memory,std::vector<Processor> >::iterator it = domains.begin();
+       it != domains.end(); it++)
+    {
+      std::sort(it->second.begin(), it->second.end());
+      numa_leaders.push_back(it->second.front());
+      if (std::find(it->second.begin(), it->second.end(), p) != it->second.end())
+        numa_procs = it->second;
+    }
+  assert(!numa_procs.empty());
+}
+
+template<int DIM>
+/*static*/ void SlicingMapper::split_rect(const Rect<DIM> &rect, size_t pieces,
+                                          std::vector<Domain> &blocks)
+{
+  int dim = 0;
+  for (int d = 1; d < DIM; d++)
+    if ((rect.hi[d] - rect.lo[d]) > (rect.hi[dim] - rect.lo[dim]))
+      dim = d;
+  const coord_t extent = rect.hi[dim] - rect.lo[dim] + 1;
+  if ((coord_t)pieces > extent)
+    pieces = extent;
+  for (size_t i = 0; i < pieces; i++)
+    {
+      Rect<DIM> block = rect;
+      block.lo[dim] = rect.lo[dim] + (extent * i) / pieces;
+      block.hi[dim] = rect.lo[dim] + (extent * (i+1)) / pieces - 1;
+      blocks.push_back(Domain(block));
+    }
+}
+
+/*static*/
+void SlicingMapper::split_domain(const Domain &domain, size_t pieces,
+                                 std::vector<Domain> &blocks)
+{
+  switch (domain.get_dim())
+    {
+    case 1:
+      split_rect<1>(domain, pieces, blocks);
+      break;
+#if LEGION_MAX_DIM >= 2
+    case 2:
+      split_rect<2>(domain, pieces, blocks);
+      break;
+#endif
+#if LEGION_MAX_DIM >= 3
+    case 3:
+      split_rect<3>(domain, pieces, blocks);
+      break;
+#endif
+    default:
+      assert(false);
+    }
+}
+
+/*static*/
+bool SlicingMapper::is_block_of(const Domain &domain, const Domain &parent, size_t pieces)
+{
+  std::vector<Domain> blocks;
+  split_domain(parent, pieces, blocks);
+  return (std::find(blocks.begin(), blocks.end(), domain) != blocks.end());
+}
+
+void SlicingMapper::slice_task(const MapperContext ctx,
+                               const Task &task,
+                               const SliceTaskInput &input,
+                               SliceTaskOutput &output)
+{
+  const Domain &domain = input.domain;
+  if (use_default || !domain.dense() || (domain.get_dim() > 3))
+    {
+      DefaultMapper::slice_task(ctx, task, input, output);
+      return;
+    }
+  std::vector<Domain> blocks;
+  // The whole launch: one block per address space
+  if ((domain == task.index_domain) && (space_leaders.size() > 1))
+    {
+      split_domain(domain, space_leaders.size(), blocks);
+      if (blocks.size() > 1)
+        {
+          for (unsigned i = 0; i < blocks.size(); i++)
+            output.slices.push_back(TaskSlice(blocks[i], space_leaders[i],
+                                              true/*recurse*/, false/*stealable*/));
+          return;
+        }
+      blocks.clear();
+    }
+  // The block of an address space: one block per NUMA domain
+  if ((numa_leaders.size() > 1) &&
+      ((domain == task.index_domain) ||
+       is_block_of(domain, task.index_domain, space_leaders.size())))
+    {
+      split_domain(domain, numa_leaders.size(), blocks);
+      if (blocks.size() > 1)
+        {
+          for (unsigned i = 0; i < blocks.size(); i++)
+            output.slices.push_back(TaskSlice(blocks[i], numa_leaders[i],
+                                              true/*recurse*/, false/*stealable*/));
+          return;
+        }
+      blocks.clear();
+    }
+  // The block of a NUMA domain: one block per processor
+  split_domain(domain, numa_procs.size(), blocks);
+  for (unsigned i = 0; i < blocks.size(); i++)
+    output.slices.push_back(TaskSlice(blocks[i], numa_procs[i],
+                                      false/*recurse*/, false/*stealable*/));
+}
+
+/*static*/
+void SlicingMapper::register_slicing_mappers(Machine machine, Runtime *rt,
+                                             const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new SlicingMapper(map_rt, machine, *it), *it);
+    }
+}
+
+//
+//  The top level task.  Times index launches of a trivial task over domains of
+//  increasing size, from 10^3 points up to the given maximum.
+//
+//  Command line options:
+//    -max N   size of the largest launch domain (up to 10^7 is reasonable)
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  long long max_points = 100000;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_points = atoll(command_args.argv[++i]);
+    }
+
+  ArgumentMap arg_map;
+  for (long long points = 1000; points <= max_points; points *= 10)
+    {
+      const Rect<1> launch_domain(0, points - 1);
+      IndexLauncher launcher(POINT_TASK_ID, launch_domain, TaskArgument(NULL,0), arg_map);
+      const double start = Realm::Clock::current_time_in_microseconds();
+      FutureMap fm = runtime->execute_index_space(ctx, launcher);
+      fm.wait_all_results();
+      const double stop = Realm::Clock::current_time_in_microseconds();
+      printf("%10lld points: %10.3f ms, %10.3f us per point\n",
+             points, (stop - start) * 1e-3, (stop - start) / points);
+    }
+}
+
+void point_task(const Task *task,
+		const std::vector<PhysicalRegion> &regions,
+		Context ctx,
+		Runtime *runtime)
+{
+  assert(task->index_domain.contains(task->index_point));
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(POINT_TASK_ID, "point_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<point_task>(registrar);
+  }
+  Runtime::add_registration_callback(SlicingMapper::register_slicing_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,336 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  SUM_TREE_ID,
+};
+
+//
+// The argument of a sum tree task: sum the range [low,high], splitting the range
+// at low + skew * (high - low) until it is at most leaf_size elements long.
+// Each leaf spins for work_per_elem iterations per element to simulate real work.
+//
+struct SumTreeArgs {
+  long long low, high;
+  long long leaf_size;
+  double skew;
+  int work_per_elem;
+};
+
+//
+// A mapper that lets idle processors steal work from busy ones.  Victims are
+// chosen among processors of the same kind, preferring processors that share a
+// NUMA domain (a socket memory) with the thief.  A victim gives away at most
+// max_steal_batch tasks per request, and tasks that name logical regions are only
+// given to thieves in the same NUMA domain, since their data is likely resident
+// in the victim's memory.
+//
+// Command line options:
+//   -steal:off       disable stealing (tasks stay where they were launched)
+//   -steal:batch N   maximum number of tasks given away per steal request
+//   -steal:targets N maximum number of victims asked per steal attempt
+//
+class StealingMapper : public DefaultMapper {
+public:
+  StealingMapper(MapperRuntime *rt, Machine m, Processor p);
+public:
+  virtual void select_task_options(const MapperContext ctx,
+                                   const Task &task,
+                                   TaskOptions &output);
+  virtual void select_steal_targets(const MapperContext ctx,
+                                    const SelectStealingInput &input,
+                                    SelectStealingOutput &output);
+  virtual void permit_steal_request(const MapperContext ctx,
+                                    const StealRequestInput &input,
+                                    StealRequestOutput &output);
+public:
+  static void register_stealing_mappers(Machine machine, Runtime *rt,
+                                        const std::set<Processor> &local_procs);
+protected:
+  void add_victims(const std::vector<Processor> &candidates,
+                   const std::set<Processor> &blacklist,
+                   unsigned &next, std::set<Processor> &targets);
+protected:
+  bool enable_stealing;
+  unsigned max_steal_batch;
+  unsigned max_steal_targets;
+  // Processors of our kind in our NUMA domain, and everywhere else
+  std::vector<Processor> near_victims;
+  std::vector<Processor> far_victims;
+  std::set<Processor> near_procs;
+  // Round-robin cursors so repeated steal attempts spread over the victims
+  unsigned next_near, next_far;
+};
+
+StealingMapper::StealingMapper(MapperRuntime *rt, Machine m, Processor p)
+  : DefaultMapper(rt, m, p, "stealing_mapper"),
+    enable_stealing(true), max_steal_batch(4), max_steal_targets(2),
+    next_near(0), next_far(0)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-steal:off"))
+        enable_stealing = false;
+      else if (!strcmp(command_args.argv[i], "-steal:batch") && (i+1) < command_args.argc)
+        max_steal_batch = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-steal:targets") && (i+1) < command_args.argc)
+        max_steal_targets = atoi(command_args.argv[++i]);
+    }
+
+  // Our NUMA domain is the set of processors with affinity to the socket memory
+  // closest to us.  Without NUMA support there are no socket memories and we fall
+  // back to treating the system memory of our node as a single domain.
+  Machine::MemoryQuery numa_query(m);
+  numa_query.only_kind(Memory::SOCKET_MEM);
+  numa_query.has_affinity_to(p);
+  Memory numa_mem = numa_query.first();
+  if (!numa_mem.exists())
+    {
+      Machine::MemoryQuery sys_query(m);
+      sys_query.only_kind(Memory::SYSTEM_MEM);
+      sys_query.has_affinity_to(p);
+      numa_mem = sys_query.first();
+    }
+  if (numa_mem.exists())
+    {
+      Machine::ProcessorQuery near_query(m);
+      near_query.only_kind(p.kind());
+      near_query.has_affinity_to(numa_mem);
+      for (Machine::ProcessorQuery::iterator it = near_query.begin();
+           it != near_query.end(); it++)
+        near_procs.insert(*it);
+    }
+
+  // Every other processor of our kind in the machine is a far victim
+  Machine::ProcessorQuery proc_query(m);
+  proc_query.only_kind(p.kind());
+  for (Machine::ProcessorQuery::iterator it = proc_query.begin();
+       it != proc_query.end(); it++)
+    {
+      // skip ourselves
+      if ((*it) == p)
+        continue;
+      if (near_procs.find(*it) != near_procs.end())
+        near_victims.push_back(*it);
+      else
+        far_victims.push_back(*it);
+    }
+  // Start each thief at a different victim so thieves don't all pile onto one processor
+  if (!near_victims.empty())
+    next_near = p.id % near_victims.size();
+  if (!far_victims.empty())
+    next_far = p.id % far_victims.size();
+}
+
+void StealingMapper::select_task_options(const MapperContext ctx,
+                                         const Task &task,
+                                         TaskOptions &output)
+{
+  DefaultMapper::select_task_options(ctx, task, output);
+  // Keep each task on the processor that launched it.  The initial distribution
+  // is therefore completely static and any balancing comes from stealing.
+  output.initial_proc = local_proc;
+  // The top-level task is never worth moving
+  output.stealable = enable_stealing && (task.get_depth() > 0);
+}
+
+void StealingMapper::add_victims(const std::vector<Processor> &candidates,
+                                 const std::set<Processor> &blacklist,
+                                 unsigned &next, std::set<Processor> &targets)
+{
+  for (unsigned i = 0; i < candidates.size(); i++)
+    {
+      if (targets.size() >= max_steal_targets)
+        return;
+      const Processor victim = candidates[(next + i) % candidates.size()];
+      // The runtime blacklists victims that had nothing to steal last time
+      if (blacklist.find(victim) != blacklist.end())
+        continue;
+      targets.insert(victim);
+    }
+  if (!candidates.empty())
+    next = (next + 1) % candidates.size();
+}
+
+void StealingMapper::select_steal_targets(const MapperContext ctx,
+                                          const SelectStealingInput &input,
+                                          SelectStealingOutput &output)
+{
+  if (!enable_stealing)
+    return;
+  // Try our own NUMA domain first and only go further afield if every near
+  // victim is blacklisted.
+  add_victims(near_victims, input.blacklist, next_near, output.targets);
+  if (output.targets.empty())
+    add_victims(far_victims, input.blacklist, next_far, output.targets);
+}
+
+void StealingMapper::permit_steal_request(const MapperContext ctx,
+                                          const StealRequestInput &input,
+                                          StealRequestOutput &output)
+{
+  if (!enable_stealing)
+    return;
+  const bool near_thief = (near_procs.find(input.thief_proc) != near_procs.end());
+  // The stealable tasks are listed in the order they would run here; give away
+  // the ones at the back of the queue, which we would get to last.
+  for (std::vector<const Task*>::const_reverse_iterator it = input.stealable_tasks.rbegin();
+       it != input.stealable_tasks.rend(); it++)
+    {
+      if (output.stolen_tasks.size() >= max_steal_batch)
+        break;
+      // Tasks with region requirements stay within our NUMA domain
+      if (!near_thief && !(*it)->regions.empty())
+        continue;
+      output.stolen_tasks.insert(*it);
+    }
+}
+
+/*static*/
+void StealingMapper::register_stealing_mappers(Machine machine, Runtime *rt,
+                                               const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new StealingMapper(map_rt, machine, *it), *it);
+    }
+}
+
+//
+//  The top level task.  Runs several trials of a skewed summation tree and reports
+//  the time of each trial together with the median and worst (tail) time.
+//
+//  Command line options:
+//    -n N        sum the range [0,N]
+//    -leaf N     largest range summed by a single leaf task
+//    -skew F     fraction of each range given to the low half (0.5 is balanced)
+//    -work N     spin iterations per element in the leaves
+//    -trials N   number of times to repeat the computation
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  SumTreeArgs args;
+  args.low = 0;
+  args.high = 100000;
+  args.leaf_size = 1000;
+  args.skew = 0.9;
+  args.work_per_elem = 100;
+  int trials = 3;
+
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        args.high = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-leaf") && (i+1) < command_args.argc)
+        args.leaf_size = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-skew") && (i+1) < command_args.argc)
+        args.skew = atof(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-work") && (i+1) < command_args.argc)
+        args.work_per_elem = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-trials") && (i+1) < command_args.argc)
+        trials = atoi(command_args.argv[++i]);
+    }
+  assert(args.high >= 0);
+  assert(args.leaf_size > 0);
+  assert((args.skew > 0.0) && (args.skew < 1.0));
+  assert(trials > 0);
+
+  printf("Summing 0 to %lld with leaves of %lld elements and skew %.2f\n",
+         args.high, args.leaf_size, args.skew);
+
+  const long long expected = args.high * (args.high + 1) / 2;
+  std::vector<double> times;
+  for (int t = 0; t < trials; t++)
+    {
+      const double start = Realm::Clock::current_time_in_microseconds();
+      TaskLauncher launcher(SUM_TREE_ID, TaskArgument(&args, sizeof(args)));
+      Future sum = runtime->execute_task(ctx, launcher);
+      long long result = sum.get_result<long long>();
+      const double stop = Realm::Clock::current_time_in_microseconds();
+      assert(result == expected);
+      times.push_back((stop - start) * 1e-3);
+      printf("Trial %d: %.3f ms\n", t, times.back());
+    }
+  std::sort(times.begin(), times.end());
+  printf("Median %.3f ms, max %.3f ms\n", times[times.size() / 2], times.back());
+}
+
+//
+//  Sums a range of integers by recursively splitting it at the skewed midpoint.
+//  A large skew gives a lopsided tree: the processor that gets the big half of
+//  every split does most of the work unless idle processors steal some of it.
+//
+long long sum_tree_task(const Task *task,
+			const std::vector<PhysicalRegion> &regions,
+			Context ctx,
+			Runtime *runtime)
+{
+  const SumTreeArgs args = *((const SumTreeArgs *) task->args);
+
+  if ((args.high - args.low) < args.leaf_size)
+    {
+      long long sum = 0;
+      for (long long i = args.low; i <= args.high; i++)
+        {
+          // Spin to give the leaf some weight; volatile keeps the loop alive
+          volatile int work = 0;
+          for (int w = 0; w < args.work_per_elem; w++)
+            work = work + 1;
+          sum += i;
+        }
+      return sum;
+    }
+
+  long long midpoint = args.low + (long long)((args.high - args.low) * args.skew);
+  if (midpoint >= args.high)
+    midpoint = args.high - 1;
+
+  SumTreeArgs lowargs = args;
+  lowargs.high = midpoint;
+  TaskLauncher lowlauncher(SUM_TREE_ID, TaskArgument(&lowargs, sizeof(lowargs)));
+  Future lowsum = runtime->execute_task(ctx, lowlauncher);
+
+  SumTreeArgs highargs = args;
+  highargs.low = midpoint + 1;
+  TaskLauncher highlauncher(SUM_TREE_ID, TaskArgument(&highargs, sizeof(highargs)));
+  Future highsum = runtime->execute_task(ctx, highlauncher);
+
+  return lowsum.get_result<long long>() + highsum.get_result<long long>();
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TREE_ID, "sum_tree");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<long long,sum_tree_task>(registrar);
+  }
+  Runtime::add_registration_callback(StealingMapper::register_stealing_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include "legion.h"
+#include "default_mapper.h"
+#include "timing_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  INIT_TASK_ID,
+  SUM_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+//
+// Exercises the most common mapper calls: single and index task launches, and an
+// inline mapping.  The optional command line argument is the number of iterations.
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int iterations = 10;
+  const InputArgs &command_args = Runtime::get_input_args();
+  if (command_args.argc > 1)
+    {
+      iterations = atoi(command_args.argv[1]);
+      assert(iterations >= 0);
+    }
+
+  Rect<1> rec(Point<1>(0),Point<1>(999));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+
+  int num_subregions = 4;
+  Rect<1> colors(0,num_subregions - 1);
+  IndexSpace color_is = rt->create_index_space(ctx, colors);
+  IndexPartition ip = rt->create_equal_partition(ctx, is, color_is);
+  LogicalPartition lp = rt->get_logical_partition(ctx, lr, ip);
+
+  ArgumentMap arg_map;
+  for (int i = 0; i < iterations; i++) {
+    TaskLauncher init_launcher(INIT_TASK_ID, TaskArgument(&i,sizeof(i)));
+    init_launcher.add_region_requirement(RegionRequirement(lr, WRITE_DISCARD, EXCLUSIVE, lr));
+    init_launcher.add_field(0, FIELD_A);
+    rt->execute_task(ctx, init_launcher);
+
+    IndexLauncher sum_launcher(SUM_TASK_ID, colors, TaskArgument(NULL,0), arg_map);
+    sum_launcher.add_region_requirement(RegionRequirement(lp, 0, READ_ONLY, EXCLUSIVE, lr));
+    sum_launcher.region_requirements[0].add_field(FIELD_A);
+    rt->execute_index_space(ctx, sum_launcher);
+  }
+
+  InlineLauncher launcher(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr).add_field(0,FIELD_A));
+  PhysicalRegion pr = rt->map_region(ctx, launcher);
+  pr.wait_until_valid();
+  rt->unmap_region(ctx, pr);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,color_is);
+  rt->destroy_index_space(ctx,is);
+}
+
+void init_task(const Task *task,
+               const std::vector<PhysicalRegion> &rgns,
+               Context ctx, Runtime *rt)
+{
+  int value = *((const int *) task->args);
+  const FieldAccessor<WRITE_DISCARD,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx, task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = value;
+    }
+}
+
+void sum_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  int sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_a[*itr];
+    }
+  assert(sum == (int)d.volume() * fa_a[d.lo]);
+}
+
+//
+// Wrap the default mapper on every processor in a timing mapper.  Any custom
+// mapper can be wrapped the same way.
+//
+void register_timing_mappers(Machine machine, Runtime *rt,
+                             const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(
+          new TimingMapper(map_rt, new DefaultMapper(map_rt, machine, *it)), *it);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_TASK_ID, "init_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<sum_task>(registrar);
+  }
+  Runtime::add_registration_callback(register_timing_mappers);
+
+  int result = Runtime::start(argc, argv);
+  // Runtime::start returns once the runtime has shut down, so every mapper call has been recorded
+  TimingMapper::print_report();
+  return result;
+}
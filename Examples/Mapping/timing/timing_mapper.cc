@@ -0,0 +1,187 @@
+#include <cstdio>
+#include "timing_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+CallHistogram::CallHistogram(void)
+  : count(0), total_ns(0), max_ns(0)
+{
+  for (unsigned i = 0; i < NUM_BUCKETS; i++)
+    buckets[i] = 0;
+}
+
+void CallHistogram::record(unsigned long long ns)
+{
+  count++;
+  total_ns += ns;
+  if (ns > max_ns)
+    max_ns = ns;
+  // The bucket is the position of the most significant bit of the duration
+  unsigned bucket = 0;
+  while (((ns >> 1) > 0) && (bucket < (NUM_BUCKETS - 1)))
+    {
+      ns >>= 1;
+      bucket++;
+    }
+  buckets[bucket]++;
+}
+
+void CallHistogram::merge(const CallHistogram &rhs)
+{
+  count += rhs.count;
+  total_ns += rhs.total_ns;
+  if (rhs.max_ns > max_ns)
+    max_ns = rhs.max_ns;
+  for (unsigned i = 0; i < NUM_BUCKETS; i++)
+    buckets[i] += rhs.buckets[i];
+}
+
+void CallHistogram::print(const char *name) const
+{
+  if (count == 0)
+    return;
+  printf("%-22s %10llu calls  mean %10.3f us  max %10.3f us  total %10.3f ms\n",
+         name, count, (total_ns * 1e-3) / count, max_ns * 1e-3, total_ns * 1e-6);
+  for (unsigned i = 0; i < NUM_BUCKETS; i++)
+    {
+      if (buckets[i] == 0)
+        continue;
+      printf("    [%10.3f us, %10.3f us) %10llu\n",
+             (1ULL << i) * 1e-3, (1ULL << (i+1)) * 1e-3, buckets[i]);
+    }
+}
+
+/*static*/ std::mutex TimingMapper::report_lock;
+/*static*/ std::vector<CallHistogram*> TimingMapper::all_histograms;
+
+TimingMapper::TimingMapper(MapperRuntime *rt, Mapper *inner)
+  : ForwardingMapper(rt, inner), histograms(new CallHistogram[NUM_CALL_KINDS])
+{
+  std::lock_guard<std::mutex> guard(report_lock);
+  all_histograms.push_back(histograms);
+}
+
+TimingMapper::CallTimer::CallTimer(TimingMapper *m, CallKind k)
+  : mapper(m), kind(k), start(Realm::Clock::current_time_in_nanoseconds())
+{
+}
+
+TimingMapper::CallTimer::~CallTimer(void)
+{
+  const long long stop = Realm::Clock::current_time_in_nanoseconds();
+  std::lock_guard<std::mutex> guard(mapper->histogram_lock);
+  mapper->histograms[kind].record(stop - start);
+}
+
+void TimingMapper::select_task_options(const MapperContext ctx,
+                                       const Task &task,
+                                       TaskOptions &output)
+{
+  CallTimer timer(this, SELECT_TASK_OPTIONS);
+  ForwardingMapper::select_task_options(ctx, task, output);
+}
+
+void TimingMapper::slice_task(const MapperContext ctx,
+                              const Task &task,
+                              const SliceTaskInput &input,
+                              SliceTaskOutput &output)
+{
+  CallTimer timer(this, SLICE_TASK);
+  ForwardingMapper::slice_task(ctx, task, input, output);
+}
+
+void TimingMapper::select_tasks_to_map(const MapperContext ctx,
+                                       const SelectMappingInput &input,
+                                       SelectMappingOutput &output)
+{
+  CallTimer timer(this, SELECT_TASKS_TO_MAP);
+  ForwardingMapper::select_tasks_to_map(ctx, input, output);
+}
+
+void TimingMapper::map_task(const MapperContext ctx,
+                            const Task &task,
+                            const MapTaskInput &input,
+                            MapTaskOutput &output)
+{
+  CallTimer timer(this, MAP_TASK);
+  ForwardingMapper::map_task(ctx, task, input, output);
+}
+
+void TimingMapper::select_task_sources(const MapperContext ctx,
+                                       const Task &task,
+                                       const SelectTaskSrcInput &input,
+                                       SelectTaskSrcOutput &output)
+{
+  CallTimer timer(this, SELECT_TASK_SOURCES);
+  ForwardingMapper::select_task_sources(ctx, task, input, output);
+}
+
+void TimingMapper::postmap_task(const MapperContext ctx,
+                                const Task &task,
+                                const PostMapInput &input,
+                                PostMapOutput &output)
+{
+  CallTimer timer(this, POSTMAP_TASK);
+  ForwardingMapper::postmap_task(ctx, task, input, output);
+}
+
+void TimingMapper::map_inline(const MapperContext ctx,
+                              const InlineMapping &inline_op,
+                              const MapInlineInput &input,
+                              MapInlineOutput &output)
+{
+  CallTimer timer(this, MAP_INLINE);
+  ForwardingMapper::map_inline(ctx, inline_op, input, output);
+}
+
+void TimingMapper::map_copy(const MapperContext ctx,
+                            const Copy &copy,
+                            const MapCopyInput &input,
+                            MapCopyOutput &output)
+{
+  CallTimer timer(this, MAP_COPY);
+  ForwardingMapper::map_copy(ctx, copy, input, output);
+}
+
+void TimingMapper::select_steal_targets(const MapperContext ctx,
+                                        const SelectStealingInput &input,
+                                        SelectStealingOutput &output)
+{
+  CallTimer timer(this, SELECT_STEAL_TARGETS);
+  ForwardingMapper::select_steal_targets(ctx, input, output);
+}
+
+void TimingMapper::permit_steal_request(const MapperContext ctx,
+                                        const StealRequestInput &input,
+                                        StealRequestOutput &output)
+{
+  CallTimer timer(this, PERMIT_STEAL_REQUEST);
+  ForwardingMapper::permit_steal_request(ctx, input, output);
+}
+
+/*static*/
+void TimingMapper::print_report(void)
+{
+  static const char *const call_names[NUM_CALL_KINDS] = {
+    "select_task_options",
+    "slice_task",
+    "select_tasks_to_map",
+    "map_task",
+    "select_task_sources",
+    "postmap_task",
+    "map_inline",
+    "map_copy",
+    "select_steal_targets",
+    "permit_steal_request",
+  };
+  std::lock_guard<std::mutex> guard(report_lock);
+  CallHistogram merged[NUM_CALL_KINDS];
+  for (std::vector<CallHistogram*>::const_iterator it = all_histograms.begin();
+       it != all_histograms.end(); it++)
+    for (unsigned kind = 0; kind < NUM_CALL_KINDS; kind++)
+      merged[kind].merge((*it)[kind]);
+  printf("Mapper call times for %zu mappers:\n", all_histograms.size());
+  for (unsigned kind = 0; kind < NUM_CALL_KINDS; kind++)
+    merged[kind].print(call_names[kind]);
+}
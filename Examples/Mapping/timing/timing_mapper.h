@@ -0,0 +1,121 @@
+#ifndef __TIMING_MAPPER_H__
+#define __TIMING_MAPPER_H__
+
+#include <mutex>
+#include <vector>
+#include "legion.h"
+#include "forwarding_mapper.h"
+
+//
+// A histogram of the durations of one kind of mapper call.  Bucket i counts the
+// calls that took between 2^i and 2^(i+1) nanoseconds.
+//
+class CallHistogram {
+public:
+  static const unsigned NUM_BUCKETS = 40;
+public:
+  CallHistogram(void);
+public:
+  void record(unsigned long long ns);
+  void merge(const CallHistogram &rhs);
+  void print(const char *name) const;
+public:
+  unsigned long long count;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+  unsigned long long buckets[NUM_BUCKETS];
+};
+
+//
+// A mapper adaptor that forwards every call to an inner mapper and records how
+// long the most important callbacks take.  To time a custom mapper, replace
+//
+//     new MyMapper(...)
+//
+// with
+//
+//     new TimingMapper(map_rt, new MyMapper(...))
+//
+// and call TimingMapper::print_report() after Runtime::start returns.  The
+// histograms of all the timing mappers in the process are merged in the report.
+//
+class TimingMapper : public Legion::Mapping::ForwardingMapper {
+public:
+  enum CallKind {
+    SELECT_TASK_OPTIONS,
+    SLICE_TASK,
+    SELECT_TASKS_TO_MAP,
+    MAP_TASK,
+    SELECT_TASK_SOURCES,
+    POSTMAP_TASK,
+    MAP_INLINE,
+    MAP_COPY,
+    SELECT_STEAL_TARGETS,
+    PERMIT_STEAL_REQUEST,
+    NUM_CALL_KINDS,
+  };
+public:
+  TimingMapper(Legion::Mapping::MapperRuntime *rt, Legion::Mapping::Mapper *inner);
+public:
+  virtual void select_task_options(const Legion::Mapping::MapperContext ctx,
+                                   const Legion::Task &task,
+                                   TaskOptions &output);
+  virtual void slice_task(const Legion::Mapping::MapperContext ctx,
+                          const Legion::Task &task,
+                          const SliceTaskInput &input,
+                          SliceTaskOutput &output);
+  virtual void select_tasks_to_map(const Legion::Mapping::MapperContext ctx,
+                                   const SelectMappingInput &input,
+                                   SelectMappingOutput &output);
+  virtual void map_task(const Legion::Mapping::MapperContext ctx,
+                        const Legion::Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+  virtual void select_task_sources(const Legion::Mapping::MapperContext ctx,
+                                   const Legion::Task &task,
+                                   const SelectTaskSrcInput &input,
+                                   SelectTaskSrcOutput &output);
+  virtual void postmap_task(const Legion::Mapping::MapperContext ctx,
+                            const Legion::Task &task,
+                            const PostMapInput &input,
+                            PostMapOutput &output);
+  virtual void map_inline(const Legion::Mapping::MapperContext ctx,
+                          const Legion::InlineMapping &inline_op,
+                          const MapInlineInput &input,
+                          MapInlineOutput &output);
+  virtual void map_copy(const Legion::Mapping::MapperContext ctx,
+                        const Legion::Copy &copy,
+                        const MapCopyInput &input,
+                        MapCopyOutput &output);
+  virtual void select_steal_targets(const Legion::Mapping::MapperContext ctx,
+                                    const SelectStealingInput &input,
+                                    SelectStealingOutput &output);
+  virtual void permit_steal_request(const Legion::Mapping::MapperContext ctx,
+                                    const StealRequestInput &input,
+                                    StealRequestOutput &output);
+public:
+  // Print the merged histograms of every timing mapper in this process
+  static void print_report(void);
+protected:
+  // Times the lifetime of a scope and records it in the histogram of a call kind
+  class CallTimer {
+  public:
+    CallTimer(TimingMapper *mapper, CallKind kind);
+    ~CallTimer(void);
+  private:
+    TimingMapper *const mapper;
+    const CallKind kind;
+    const long long start;
+  };
+protected:
+  // The histograms are owned by the report rather than the mapper, since the
+  // runtime may delete its mappers before the report is printed
+  CallHistogram *const histograms;
+  // Guards the histograms in case the inner mapper allows concurrent calls
+  std::mutex histogram_lock;
+protected:
+  static std::mutex report_lock;
+  static std::vector<CallHistogram*> all_histograms;
+};
+
+#endif // __TIMING_MAPPER_H__
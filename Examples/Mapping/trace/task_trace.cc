@@ -0,0 +1,18 @@
+#include "legion.h"
+#include "trace_mapper.h"
+
+//
+// Adding this file and trace_mapper.cc to the sources of an example that uses the
+// default mapper makes the example write a task trace when it is run with -trace FILE.
+// An example that registers a mapper of its own replaces the trace mapper, and should
+// wrap its mapper in a TraceMapper instead.
+//
+namespace {
+  struct TaskTraceRegistration {
+    TaskTraceRegistration(void)
+    {
+      Legion::Runtime::add_registration_callback(TraceMapper::register_trace_mappers);
+    }
+  };
+  TaskTraceRegistration task_trace_registration;
+}
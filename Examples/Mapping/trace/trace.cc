@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#include "trace_mapper.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  WORK_TASK_ID,
+};
+
+// Spin for the given number of microseconds
+void busy_wait(double us)
+{
+  const double stop = Realm::Clock::current_time_in_microseconds() + us;
+  while (Realm::Clock::current_time_in_microseconds() < stop) ;
+}
+
+//
+// A sequence of index launches whose point tasks take different times, so that the
+// trace shows the processors idling at the end of every stage while the longest
+// point task finishes.  Run with -trace FILE to write the trace, and with several
+// processors (e.g. -ll:cpu 4) to see the tasks of a stage side by side.
+//
+//  Command line options:
+//    -stages N    number of index launches, each waiting for the one before
+//    -colors N    point tasks per index launch
+//    -unit US     time taken by point 0; point i takes i+1 times as long
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int stages = 4;
+  int num_colors = 8;
+  double unit_us = 1000;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-stages") && (i+1) < command_args.argc)
+        stages = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        num_colors = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-unit") && (i+1) < command_args.argc)
+        unit_us = atof(command_args.argv[++i]);
+    }
+
+  Rect<1> colors(0,num_colors - 1);
+  for (int s = 0; s < stages; s++)
+    {
+      ArgumentMap arg_map;
+      IndexLauncher work_launcher(WORK_TASK_ID, colors, TaskArgument(&unit_us,sizeof(unit_us)), arg_map);
+      rt->execute_index_space(ctx, work_launcher).wait_all_results();
+    }
+  printf("Ran %d stages of %d tasks\n", stages, num_colors);
+}
+
+void work_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const double unit_us = *((const double *) task->args);
+  busy_wait(unit_us * (task->index_point[0] + 1));
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(WORK_TASK_ID, "work_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<work_task>(registrar);
+  }
+  Runtime::add_registration_callback(TraceMapper::register_trace_mappers);
+  return Runtime::start(argc, argv);
+}
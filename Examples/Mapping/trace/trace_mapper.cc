@@ -0,0 +1,198 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <string>
+#include "trace_mapper.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+/*static*/ std::mutex TraceMapper::trace_lock;
+/*static*/ std::vector<TraceEvent> TraceMapper::events;
+
+TraceMapper::TraceMapper(MapperRuntime *rt, Mapper *inner)
+  : ForwardingMapper(rt, inner)
+{
+}
+
+void TraceMapper::map_task(const MapperContext ctx,
+                           const Task &task,
+                           const MapTaskInput &input,
+                           MapTaskOutput &output)
+{
+  ForwardingMapper::map_task(ctx, task, input, output);
+  if (!output.task_prof_requests.empty())
+    {
+      std::lock_guard<std::mutex> guard(inner_profiled_lock);
+      inner_profiled.insert(task.get_unique_id());
+    }
+  output.task_prof_requests.add_measurement<Realm::ProfilingMeasurements::OperationTimeline>();
+  output.task_prof_requests.add_measurement<Realm::ProfilingMeasurements::OperationProcessorUsage>();
+}
+
+void TraceMapper::report_profiling(const MapperContext ctx,
+                                   const Task &task,
+                                   const TaskProfilingInfo &input)
+{
+  Realm::ProfilingMeasurements::OperationTimeline *timeline =
+    input.profiling_responses.get_measurement<Realm::ProfilingMeasurements::OperationTimeline>();
+  Realm::ProfilingMeasurements::OperationProcessorUsage *usage =
+    input.profiling_responses.get_measurement<Realm::ProfilingMeasurements::OperationProcessorUsage>();
+  if ((timeline != NULL) && (usage != NULL))
+    {
+      TraceEvent event;
+      event.name = task.get_task_name();
+      event.task_id = task.task_id;
+      event.uid = task.get_unique_id();
+      if (task.is_index_space)
+        event.point = task.index_point;
+      event.proc = usage->proc;
+      event.start_ns = timeline->start_time;
+      event.stop_ns = timeline->end_time;
+      std::lock_guard<std::mutex> guard(trace_lock);
+      events.push_back(event);
+    }
+  delete timeline;
+  delete usage;
+
+  bool forward = false;
+  {
+    std::lock_guard<std::mutex> guard(inner_profiled_lock);
+    forward = (inner_profiled.erase(task.get_unique_id()) > 0);
+  }
+  if (forward)
+    ForwardingMapper::report_profiling(ctx, task, input);
+}
+
+static std::string trace_file_name;
+
+static void write_trace_at_exit(void)
+{
+  TraceMapper::write_trace(trace_file_name.c_str());
+}
+
+/*static*/
+void TraceMapper::register_trace_mappers(Machine machine, Runtime *rt,
+                                         const std::set<Processor> &local_procs)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    if (!strcmp(command_args.argv[i], "-trace") && (i+1) < command_args.argc)
+      trace_file_name = command_args.argv[++i];
+  if (trace_file_name.empty() || local_procs.empty())
+    return;
+  // Each process writes the tasks that its own mappers mapped to its own file
+  const AddressSpace space = local_procs.begin()->address_space();
+  if (space > 0)
+    {
+      char suffix[32];
+      snprintf(suffix, sizeof(suffix), ".%u", (unsigned)space);
+      trace_file_name += suffix;
+    }
+  atexit(write_trace_at_exit);
+
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(
+          new TraceMapper(map_rt, new DefaultMapper(map_rt, machine, *it)), *it);
+    }
+}
+
+static const char *processor_kind_name(Processor::Kind kind)
+{
+  switch (kind)
+    {
+    case Processor::LOC_PROC: return "CPU";
+    case Processor::TOC_PROC: return "GPU";
+    case Processor::UTIL_PROC: return "Utility";
+    case Processor::IO_PROC: return "IO";
+    case Processor::OMP_PROC: return "OpenMP";
+    case Processor::PY_PROC: return "Python";
+    default: return "Processor";
+    }
+}
+
+// Task names are chosen by the application, so quote them for a JSON string
+static std::string json_escape(const std::string &text)
+{
+  std::string escaped;
+  for (std::string::const_iterator it = text.begin(); it != text.end(); it++)
+    {
+      if ((*it == '"') || (*it == '\\'))
+        escaped += '\\';
+      if ((unsigned char)*it < 0x20)
+        {
+          char code[8];
+          snprintf(code, sizeof(code), "\\u%04x", (unsigned)(unsigned char)*it);
+          escaped += code;
+        }
+      else
+        escaped += *it;
+    }
+  return escaped;
+}
+
+static bool earlier_start(const TraceEvent &lhs, const TraceEvent &rhs)
+{
+  return lhs.start_ns < rhs.start_ns;
+}
+
+//
+// The Chrome trace format: one complete ("X") event per task, with times in
+// microseconds, and one metadata event naming the row of each processor.
+//
+/*static*/
+void TraceMapper::write_trace(const char *file_name)
+{
+  std::lock_guard<std::mutex> guard(trace_lock);
+  FILE *f = fopen(file_name, "w");
+  if (f == NULL)
+    {
+      printf("Unable to write the task trace to %s\n", file_name);
+      return;
+    }
+  std::sort(events.begin(), events.end(), earlier_start);
+  const long long origin_ns = events.empty() ? 0 : events.front().start_ns;
+
+  // Number the processors in the order of their IDs, which groups them by node and kind
+  std::map<Processor,unsigned> rows;
+  for (std::vector<TraceEvent>::const_iterator it = events.begin(); it != events.end(); it++)
+    rows[it->proc] = 0;
+  unsigned next_row = 0;
+  for (std::map<Processor,unsigned>::iterator it = rows.begin(); it != rows.end(); it++)
+    it->second = next_row++;
+
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool first = true;
+  for (std::map<Processor,unsigned>::const_iterator it = rows.begin(); it != rows.end(); it++)
+    {
+      fprintf(f, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %u, \"tid\": %u, "
+              "\"args\": {\"name\": \"%s %llx\"}}",
+              first ? "" : ",\n", (unsigned)it->first.address_space(), it->second,
+              processor_kind_name(it->first.kind()), (unsigned long long)it->first.id);
+      first = false;
+    }
+  for (std::vector<TraceEvent>::const_iterator it = events.begin(); it != events.end(); it++)
+    {
+      char point[128] = "";
+      for (int d = 0; d < it->point.get_dim(); d++)
+        snprintf(point + strlen(point), sizeof(point) - strlen(point), "%s%lld",
+                 (d == 0) ? "" : ",", (long long)it->point[d]);
+      fprintf(f, "%s  {\"name\": \"%s\", \"cat\": \"task\", \"ph\": \"X\", "
+              "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %u, \"tid\": %u, "
+              "\"args\": {\"task_id\": %u, \"uid\": %llu, \"point\": \"%s\"}}",
+              first ? "" : ",\n", json_escape(it->name).c_str(),
+              (it->start_ns - origin_ns) * 1e-3, (it->stop_ns - it->start_ns) * 1e-3,
+              (unsigned)it->proc.address_space(), rows[it->proc],
+              (unsigned)it->task_id, (unsigned long long)it->uid, point);
+      first = false;
+    }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  printf("Wrote %zu tasks to the task trace %s\n", events.size(), file_name);
+}
@@ -0,0 +1,71 @@
+#ifndef __TRACE_MAPPER_H__
+#define __TRACE_MAPPER_H__
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "legion.h"
+#include "forwarding_mapper.h"
+
+//
+// One task execution: what ran, where, and when (nanoseconds of the Realm clock)
+//
+struct TraceEvent {
+  std::string name;
+  Legion::TaskID task_id;
+  Legion::UniqueID uid;
+  Legion::DomainPoint point;
+  Legion::Processor proc;
+  long long start_ns;
+  long long stop_ns;
+};
+
+//
+// A mapper adaptor that forwards every call to an inner mapper and asks the runtime
+// to profile every task it maps.  The start and stop time and the processor of each
+// task are collected in the process and written out as a Chrome trace, which can be
+// opened in chrome://tracing or https://ui.perfetto.dev, one row per processor.
+//
+// To trace an example that uses the default mapper, add task_trace.cc and
+// trace_mapper.cc to its sources and run it with -trace FILE.  A Makefile build
+// should include them through a file of its own, as Tasks/sumtree/task_trace_build.cc
+// does, so that examples do not share object files.  To trace a custom mapper, replace
+//
+//     new MyMapper(...)
+//
+// with
+//
+//     new TraceMapper(map_rt, new MyMapper(...))
+//
+// and call TraceMapper::write_trace(FILE) after Runtime::start returns.
+//
+class TraceMapper : public Legion::Mapping::ForwardingMapper {
+public:
+  TraceMapper(Legion::Mapping::MapperRuntime *rt, Legion::Mapping::Mapper *inner);
+public:
+  virtual void map_task(const Legion::Mapping::MapperContext ctx,
+                        const Legion::Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+  virtual void report_profiling(const Legion::Mapping::MapperContext ctx,
+                                const Legion::Task &task,
+                                const TaskProfilingInfo &input);
+public:
+  // Wrap the default mapper on every processor if the command line has -trace FILE,
+  // and write the trace to FILE when the process exits
+  static void register_trace_mappers(Legion::Machine machine, Legion::Runtime *rt,
+                                     const std::set<Legion::Processor> &local_procs);
+  // Write every task recorded in this process as a Chrome trace
+  static void write_trace(const char *file_name);
+protected:
+  // Tasks for which the inner mapper asked for profiling itself, and so must
+  // also be sent the report
+  std::set<Legion::UniqueID> inner_profiled;
+  std::mutex inner_profiled_lock;
+protected:
+  static std::mutex trace_lock;
+  static std::vector<TraceEvent> events;
+};
+
+#endif // __TRACE_MAPPER_H__
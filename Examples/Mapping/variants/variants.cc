@@ -0,0 +1,326 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  SUM_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+//
+// The sum task of Partitions/equal/equal.cc has three variants under the one task ID.
+// The OpenMP variant exists only if Legion was built with OpenMP support.
+//
+enum VariantIDs {
+  SCALAR_VARIANT_ID = 1,
+  SIMD_VARIANT_ID,
+  OMP_VARIANT_ID,
+};
+
+const char *variant_name(VariantID vid)
+{
+  switch (vid)
+    {
+    case SCALAR_VARIANT_ID: return "scalar";
+    case SIMD_VARIANT_ID: return "simd";
+    case OMP_VARIANT_ID: return "openmp";
+    default: return "auto";
+    }
+}
+
+//
+// A sum task launched with a tag made by force_variant runs the given variant; untagged
+// sum tasks run the variant the mapper considers best for the size of their region.
+// The variant ID is kept in bits 8-15, clear of the default mapper's flags in the low bits.
+//
+static const MappingTagID FORCE_VARIANT_TAG = 1 << 16;
+
+MappingTagID force_variant(VariantID vid)
+{
+  assert(vid <= 0xff);
+  return FORCE_VARIANT_TAG | (((MappingTagID)vid) << 8);
+}
+
+class VariantMapper : public DefaultMapper {
+public:
+  VariantMapper(MapperRuntime *rt, Machine m, Processor p)
+    : DefaultMapper(rt, m, p, "variant_mapper") { }
+public:
+  virtual void select_task_options(const MapperContext ctx,
+                                   const Task &task,
+                                   TaskOptions &output);
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+public:
+  static void register_variant_mappers(Machine machine, Runtime *rt,
+                                       const std::set<Processor> &local_procs);
+  // Smallest regions for which the SIMD and OpenMP variants are chosen
+  static size_t simd_min, omp_min;
+protected:
+  VariantID select_sum_variant(const MapperContext ctx, const Task &task);
+};
+
+/*static*/ size_t VariantMapper::simd_min = 1 << 10;
+/*static*/ size_t VariantMapper::omp_min = 1 << 20;
+
+VariantID VariantMapper::select_sum_variant(const MapperContext ctx, const Task &task)
+{
+  if (task.tag & FORCE_VARIANT_TAG)
+    return (task.tag >> 8) & 0xff;
+  const size_t volume =
+    runtime->get_index_space_domain(ctx, task.regions[0].region.get_index_space()).get_volume();
+  if ((volume >= omp_min) && !local_omps.empty())
+    return OMP_VARIANT_ID;
+  return (volume >= simd_min) ? SIMD_VARIANT_ID : SCALAR_VARIANT_ID;
+}
+
+// The variant decides the kind of processor the sum task is sent to
+void VariantMapper::select_task_options(const MapperContext ctx,
+                                        const Task &task,
+                                        TaskOptions &output)
+{
+  DefaultMapper::select_task_options(ctx, task, output);
+  if (task.task_id != SUM_TASK_ID)
+    return;
+  if (select_sum_variant(ctx, task) == OMP_VARIANT_ID)
+    {
+      assert(!local_omps.empty());
+      output.initial_proc = local_omps.front();
+    }
+  else
+    output.initial_proc = local_cpus.front();
+}
+
+void VariantMapper::map_task(const MapperContext ctx,
+                             const Task &task,
+                             const MapTaskInput &input,
+                             MapTaskOutput &output)
+{
+  DefaultMapper::map_task(ctx, task, input, output);
+  if (task.task_id != SUM_TASK_ID)
+    return;
+  // None of the variants has layout constraints, so the instances chosen for the default
+  // mapper's preferred variant suit all of them
+  output.chosen_variant = select_sum_variant(ctx, task);
+  assert((output.chosen_variant == OMP_VARIANT_ID) ==
+         (task.target_proc.kind() == Processor::OMP_PROC));
+}
+
+//
+// Command line options of the mapper:
+//    -simd-min N   smallest region summed by the SIMD variant
+//    -omp-min N    smallest region summed by the OpenMP variant
+//
+/*static*/
+void VariantMapper::register_variant_mappers(Machine machine, Runtime *rt,
+                                             const std::set<Processor> &local_procs)
+{
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-simd-min") && (i+1) < command_args.argc)
+        simd_min = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-omp-min") && (i+1) < command_args.argc)
+        omp_min = atoll(command_args.argv[++i]);
+    }
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new VariantMapper(map_rt, machine, *it), *it);
+    }
+}
+
+// Time a sum task over the region run reps times, in microseconds per task
+double time_sum(Context ctx, Runtime *rt, LogicalRegion lr, size_t n, MappingTagID tag, int reps)
+{
+  TaskLauncher sum_launcher(SUM_TASK_ID, TaskArgument(NULL,0), Predicate::TRUE_PRED, 0, tag);
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0, FIELD_A);
+  // Warm up, so that the instance of the region already exists
+  assert(rt->execute_task(ctx, sum_launcher).get_result<long long>() == (long long)n);
+  const double start = Realm::Clock::current_time_in_microseconds();
+  std::vector<Future> sums;
+  for (int r = 0; r < reps; r++)
+    sums.push_back(rt->execute_task(ctx, sum_launcher));
+  for (int r = 0; r < reps; r++)
+    assert(sums[r].get_result<long long>() == (long long)n);
+  return (Realm::Clock::current_time_in_microseconds() - start) / reps;
+}
+
+//
+// Sums regions of increasing size with each variant forced in turn and with the variant
+// left to the mapper, showing where each variant starts to pay off.  Set the mapper's
+// thresholds (-simd-min, -omp-min) at the crossovers found on the target machine.  Run
+// with -ll:ocpu 1 -ll:othr N to get an OpenMP processor of N threads.
+//
+//  Command line options:
+//    -min N    smallest region
+//    -max N    largest region (sizes grow by factors of 4)
+//    -reps N   sum tasks timed for every size and variant
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long min_n = 1 << 6;
+  long long max_n = 1 << 24;
+  int reps = 20;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-min") && (i+1) < command_args.argc)
+        min_n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-reps") && (i+1) < command_args.argc)
+        reps = atoi(command_args.argv[++i]);
+    }
+
+  std::vector<VariantID> variants;
+  variants.push_back(SCALAR_VARIANT_ID);
+  variants.push_back(SIMD_VARIANT_ID);
+  if (Machine::ProcessorQuery(Machine::get_machine()).only_kind(Processor::OMP_PROC).count() > 0)
+    variants.push_back(OMP_VARIANT_ID);
+  else
+    printf("No OpenMP processors: the OpenMP variant is not timed\n");
+  printf("Thresholds: simd at %zu elements, openmp at %zu elements\n",
+         VariantMapper::simd_min, VariantMapper::omp_min);
+
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+
+  printf("%12s", "elements");
+  for (unsigned v = 0; v < variants.size(); v++)
+    printf(" %10s us", variant_name(variants[v]));
+  printf(" %10s us  fastest\n", variant_name(0));
+  for (long long n = min_n; n <= max_n; n *= 4)
+    {
+      Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+      IndexSpace is = rt->create_index_space(ctx,rec);
+      LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+      int init = 1;
+      rt->fill_field(ctx,lr,lr,fida,&init,sizeof(init));
+
+      printf("%12lld", n);
+      VariantID fastest = 0;
+      double fastest_us = 0;
+      for (unsigned v = 0; v < variants.size(); v++)
+        {
+          const double us = time_sum(ctx, rt, lr, n, force_variant(variants[v]), reps);
+          printf(" %10.3f us", us);
+          if ((fastest == 0) || (us < fastest_us))
+            {
+              fastest = variants[v];
+              fastest_us = us;
+            }
+        }
+      printf(" %10.3f us  %s\n", time_sum(ctx, rt, lr, n, 0, reps), variant_name(fastest));
+
+      rt->destroy_logical_region(ctx,lr);
+      rt->destroy_index_space(ctx,is);
+    }
+  rt->destroy_field_space(ctx,fs);
+}
+
+// The sum task of Partitions/equal/equal.cc: correct for any layout
+long long sum_scalar_task(const Task *task,
+			  const std::vector<PhysicalRegion> &rgns,
+			  Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  long long sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_a[*itr];
+    }
+  return sum;
+}
+
+//
+// A loop over a contiguous array that the compiler vectorizes.  The default mapper's
+// instances of a 1D region are always dense; the assert checks it.
+//
+long long sum_simd_task(const Task *task,
+			const std::vector<PhysicalRegion> &rgns,
+			Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,int,1,coord_t,Realm::AffineAccessor<int,1,coord_t> > fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  size_t strides[1];
+  const int *a = fa_a.ptr(d, strides);
+  assert(strides[0] == sizeof(int));
+  const size_t n = d.volume();
+  long long sum = 0;
+  for (size_t i = 0; i < n; i++)
+    sum += a[i];
+  return sum;
+}
+
+#ifdef REALM_USE_OPENMP
+// The SIMD loop split among the threads of an OpenMP processor
+long long sum_omp_task(const Task *task,
+		       const std::vector<PhysicalRegion> &rgns,
+		       Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,int,1,coord_t,Realm::AffineAccessor<int,1,coord_t> > fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  size_t strides[1];
+  const int *a = fa_a.ptr(d, strides);
+  assert(strides[0] == sizeof(int));
+  const long long n = d.volume();
+  long long sum = 0;
+  #pragma omp parallel for reduction(+:sum)
+  for (long long i = 0; i < n; i++)
+    sum += a[i];
+  return sum;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task (scalar)");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<long long,sum_scalar_task>(registrar, "sum_task", SCALAR_VARIANT_ID);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task (simd)");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<long long,sum_simd_task>(registrar, "sum_task", SIMD_VARIANT_ID);
+  }
+#ifdef REALM_USE_OPENMP
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task (openmp)");
+    registrar.add_constraint(ProcessorConstraint(Processor::OMP_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<long long,sum_omp_task>(registrar, "sum_task", OMP_VARIANT_ID);
+  }
+#endif
+  Runtime::add_registration_callback(VariantMapper::register_variant_mappers);
+  return Runtime::start(argc, argv);
+}
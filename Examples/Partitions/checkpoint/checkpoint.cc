@@ -0,0 +1,220 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#ifdef LEGION_USE_HDF5
+#include <hdf5.h>
+#endif
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INIT_TASK_ID,
+  CHECK_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+  FIELD_CP,
+};
+
+#ifdef LEGION_USE_HDF5
+static const char *const dataset_name = "field_a";
+
+// Create an HDF5 file holding a single dataset of n doubles; attach wants it to already exist
+void create_checkpoint_file(const char *file_name, long long n)
+{
+  hid_t file_id = H5Fcreate(file_name, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  assert(file_id >= 0);
+  hsize_t dims[1] = { (hsize_t)n };
+  hid_t space_id = H5Screate_simple(1, dims, NULL);
+  assert(space_id >= 0);
+  hid_t dataset_id = H5Dcreate2(file_id, dataset_name, H5T_IEEE_F64LE, space_id,
+                                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  assert(dataset_id >= 0);
+  H5Dclose(dataset_id);
+  H5Sclose(space_id);
+  H5Fclose(file_id);
+}
+
+//
+// Attach the checkpoint region to the dataset in the file.  The subregions of the
+// checkpoint region are then hyperslabs of the dataset, and an index copy between
+// a partition of the data and the same partition of the checkpoint region moves
+// every subregion to or from its hyperslab in parallel.
+//
+PhysicalRegion attach_checkpoint(Context ctx, Runtime *rt, LogicalRegion cp_lr,
+                                 const char *file_name, LegionFileMode mode)
+{
+  std::map<FieldID,const char*> field_map;
+  field_map[FIELD_CP] = dataset_name;
+  AttachLauncher al(LEGION_EXTERNAL_HDF5_FILE, cp_lr, cp_lr);
+  al.attach_hdf5(file_name, field_map, mode);
+  return rt->attach_external_resource(ctx, al);
+}
+
+void copy_partition(Context ctx, Runtime *rt, const Rect<1> &colors,
+                    LogicalPartition src_lp, LogicalRegion src_lr, FieldID src_fid,
+                    LogicalPartition dst_lp, LogicalRegion dst_lr, FieldID dst_fid)
+{
+  IndexCopyLauncher copy_launcher(colors);
+  copy_launcher.add_copy_requirements(
+      RegionRequirement(src_lp, 0, READ_ONLY, EXCLUSIVE, src_lr),
+      RegionRequirement(dst_lp, 0, WRITE_DISCARD, EXCLUSIVE, dst_lr));
+  copy_launcher.add_src_field(0, src_fid);
+  copy_launcher.add_dst_field(0, dst_fid);
+  rt->issue_copy_operation(ctx, copy_launcher);
+}
+#endif
+
+//
+// Checkpoints the equal partition of Partitions/equal/equal.cc to an HDF5 file
+// and restarts from it into a fresh region, for several numbers of subregions.
+//
+//  Command line options:
+//    -n N            number of doubles in the region
+//    -colors MAX     largest number of subregions (the counts used are 1, 2, 4, ..., MAX)
+//    -file NAME      path of the checkpoint file, which is removed at the end
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+#ifdef LEGION_USE_HDF5
+  long long n = 1 << 22;
+  int max_colors = 8;
+  const char *file_name = "checkpoint.h5";
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        max_colors = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-file") && (i+1) < command_args.argc)
+        file_name = command_args.argv[++i];
+    }
+  const double gigabytes = n * sizeof(double) * 1e-9;
+  printf("Checkpointing %lld doubles (%.3f GB)\n", n, gigabytes);
+
+  Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(double), FIELD_A);
+  assert(fida == FIELD_A);
+  FieldSpace cp_fs = rt->create_field_space(ctx);
+  FieldAllocator cp_allocator = rt->create_field_allocator(ctx,cp_fs);
+  FieldID fidcp = cp_allocator.allocate_field(sizeof(double), FIELD_CP);
+  assert(fidcp == FIELD_CP);
+
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+  LogicalRegion cp_lr = rt->create_logical_region(ctx,is,cp_fs);
+
+  for (int num_subregions = 1; num_subregions <= max_colors; num_subregions *= 2)
+    {
+      Rect<1> colors(0,num_subregions - 1);
+      IndexSpace color_is = rt->create_index_space(ctx, colors);
+      IndexPartition ip = rt->create_equal_partition(ctx, is, color_is);
+      LogicalPartition lp = rt->get_logical_partition(ctx, lr, ip);
+      LogicalPartition cp_lp = rt->get_logical_partition(ctx, cp_lr, ip);
+
+      ArgumentMap arg_map;
+      IndexLauncher init_launcher(INIT_TASK_ID, colors, TaskArgument(NULL,0), arg_map);
+      init_launcher.add_region_requirement(RegionRequirement(lp, 0, WRITE_DISCARD, EXCLUSIVE, lr));
+      init_launcher.region_requirements[0].add_field(FIELD_A);
+      rt->execute_index_space(ctx, init_launcher);
+      rt->issue_execution_fence(ctx).get_void_result();
+
+      // Checkpoint: each subregion is copied to its hyperslab of the file
+      create_checkpoint_file(file_name, n);
+      double start = Realm::Clock::current_time_in_microseconds();
+      PhysicalRegion cp_pr = attach_checkpoint(ctx, rt, cp_lr, file_name, LEGION_FILE_READ_WRITE);
+      copy_partition(ctx, rt, colors, lp, lr, FIELD_A, cp_lp, cp_lr, FIELD_CP);
+      rt->detach_external_resource(ctx, cp_pr).get_void_result();
+      double stop = Realm::Clock::current_time_in_microseconds();
+      const double checkpoint_secs = (stop - start) * 1e-6;
+
+      // Restart: read every hyperslab back into a fresh region
+      LogicalRegion restart_lr = rt->create_logical_region(ctx,is,fs);
+      LogicalPartition restart_lp = rt->get_logical_partition(ctx, restart_lr, ip);
+      start = Realm::Clock::current_time_in_microseconds();
+      cp_pr = attach_checkpoint(ctx, rt, cp_lr, file_name, LEGION_FILE_READ_ONLY);
+      copy_partition(ctx, rt, colors, cp_lp, cp_lr, FIELD_CP, restart_lp, restart_lr, FIELD_A);
+      rt->detach_external_resource(ctx, cp_pr).get_void_result();
+      rt->issue_execution_fence(ctx).get_void_result();
+      stop = Realm::Clock::current_time_in_microseconds();
+      const double restart_secs = (stop - start) * 1e-6;
+
+      IndexLauncher check_launcher(CHECK_TASK_ID, colors, TaskArgument(NULL,0), arg_map);
+      check_launcher.add_region_requirement(RegionRequirement(restart_lp, 0, READ_ONLY, EXCLUSIVE, restart_lr));
+      check_launcher.region_requirements[0].add_field(FIELD_A);
+      rt->execute_index_space(ctx, check_launcher).wait_all_results();
+
+      printf("%4d subregions: checkpoint %8.3f GB/s  restart %8.3f GB/s\n",
+             num_subregions, gigabytes / checkpoint_secs, gigabytes / restart_secs);
+
+      rt->destroy_logical_region(ctx,restart_lr);
+      rt->destroy_index_partition(ctx,ip);
+      rt->destroy_index_space(ctx,color_is);
+    }
+  remove(file_name);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_logical_region(ctx,cp_lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_field_space(ctx,cp_fs);
+  rt->destroy_index_space(ctx,is);
+#else
+  printf("This example requires Legion to be built with HDF5 support.\n");
+#endif
+}
+
+void init_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const FieldAccessor<WRITE_DISCARD,double,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = (*itr)[0];
+    }
+}
+
+void check_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,double,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      assert(fa_a[*itr] == (*itr)[0]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_TASK_ID, "init_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CHECK_TASK_ID, "check_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<check_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
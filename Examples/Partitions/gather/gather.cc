@@ -0,0 +1,317 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INIT_TASK_ID,
+  PTR_TASK_ID,
+  SUM_IMAGE_TASK_ID,
+  SUM_GATHERED_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_VAL,
+  FIELD_PTR,
+  FIELD_GATHERED,
+};
+
+enum Patterns {
+  PATTERN_LOCAL,
+  PATTERN_SHIFTED,
+  PATTERN_RANDOM,
+};
+
+static const char *const pattern_names[] = { "local", "shifted", "random" };
+
+struct PtrArgs {
+  long long n;
+  int pattern;
+  int num_colors;
+};
+
+double best_of(double a, double b)
+{
+  return (a < b) ? a : b;
+}
+
+//
+// The approach of Partitions/image/image.cc: build the image partition of the
+// pointer field and give each point task the subregion of values its pointers reach.
+//
+double run_image(Context ctx, Runtime *rt, IndexSpace is, LogicalRegion lr_src,
+                 LogicalPartition lp_src, LogicalRegion lr_dst, IndexSpace cis,
+                 const Rect<1> &colors, FutureMap &sums,
+                 size_t &bounds_elements, size_t &image_elements)
+{
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  IndexPartition ip_dst = rt->create_partition_by_image(ctx, is, lp_src, lr_src, FIELD_PTR, cis);
+  LogicalPartition lp_dst = rt->get_logical_partition(ctx, lr_dst, ip_dst);
+  ArgumentMap arg_map;
+  IndexLauncher sum_launcher(SUM_IMAGE_TASK_ID, colors, TaskArgument(NULL,0), arg_map);
+  sum_launcher.add_region_requirement(RegionRequirement(lp_src, 0, READ_ONLY, EXCLUSIVE, lr_src));
+  sum_launcher.region_requirements[0].add_field(FIELD_PTR);
+  sum_launcher.add_region_requirement(RegionRequirement(lp_dst, 0, READ_ONLY, EXCLUSIVE, lr_dst));
+  sum_launcher.region_requirements[1].add_field(FIELD_VAL);
+  sums = rt->execute_index_space(ctx, sum_launcher);
+  sums.wait_all_results();
+  const double stop = Realm::Clock::current_time_in_microseconds();
+
+  // An instance of a subregion spans its bounding box unless the mapper asks otherwise
+  bounds_elements = 0;
+  image_elements = 0;
+  for (PointInRectIterator<1> itr(colors); itr(); itr++)
+    {
+      Domain d = rt->get_index_space_domain(ctx, rt->get_index_subspace(ctx, ip_dst, *itr));
+      bounds_elements += d.bounds<1,coord_t>().volume();
+      image_elements += d.get_volume();
+    }
+  rt->destroy_index_partition(ctx, ip_dst);
+  return stop - start;
+}
+
+//
+// Gather the values each point task needs into its own subregion of a buffer region
+// with an indirect index copy, and give each point task its compact subregion of the
+// buffer instead.  Subregion i of the buffer receives the values that the pointers
+// in subregion i of the source point to, in the same order.
+//
+double run_gather(Context ctx, Runtime *rt, LogicalRegion lr_src, LogicalPartition lp_src,
+                  LogicalRegion lr_dst, LogicalRegion lr_buf, LogicalPartition lp_buf,
+                  const Rect<1> &colors, FutureMap &sums)
+{
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  IndexCopyLauncher copy_launcher(colors);
+  copy_launcher.add_copy_requirements(
+      RegionRequirement(lr_dst, 0, READ_ONLY, EXCLUSIVE, lr_dst),
+      RegionRequirement(lp_buf, 0, WRITE_DISCARD, EXCLUSIVE, lr_buf));
+  copy_launcher.add_src_field(0, FIELD_VAL);
+  copy_launcher.add_dst_field(0, FIELD_GATHERED);
+  copy_launcher.add_src_indirect_field(FIELD_PTR,
+      RegionRequirement(lp_src, 0, READ_ONLY, EXCLUSIVE, lr_src));
+  rt->issue_copy_operation(ctx, copy_launcher);
+  ArgumentMap arg_map;
+  IndexLauncher sum_launcher(SUM_GATHERED_TASK_ID, colors, TaskArgument(NULL,0), arg_map);
+  sum_launcher.add_region_requirement(RegionRequirement(lp_buf, 0, READ_ONLY, EXCLUSIVE, lr_buf));
+  sum_launcher.region_requirements[0].add_field(FIELD_GATHERED);
+  sums = rt->execute_index_space(ctx, sum_launcher);
+  sums.wait_all_results();
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+// Each point task sums the values reached through the pointers of its subregion of
+// the pointer region, once through an image partition and once through a gather
+// copy.  The pointers follow one of three patterns:
+//
+//   local    every pointer stays within its own subregion
+//   shifted  pointers are shifted by half a subregion, so each image spans two blocks
+//   random   pointers are a scattered permutation, so each image spans the whole region
+//
+//  Command line options:
+//    -n N        number of elements, a power of two
+//    -colors N   number of subregions and point tasks
+//    -trials N   number of timed runs of each approach (the best is reported)
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long n = 1 << 18;
+  int num_colors = 4;
+  int trials = 3;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        num_colors = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-trials") && (i+1) < command_args.argc)
+        trials = atoi(command_args.argv[++i]);
+    }
+  // The random pattern is only a permutation when n is a power of two
+  assert((n & (n - 1)) == 0);
+
+  Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace src_fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,src_fs);
+    FieldID fidptr = field_allocator.allocate_field(sizeof(Point<1>), FIELD_PTR);
+    assert(fidptr == FIELD_PTR);
+  }
+  FieldSpace dst_fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,dst_fs);
+    FieldID fidv = field_allocator.allocate_field(sizeof(double), FIELD_VAL);
+    assert(fidv == FIELD_VAL);
+  }
+  FieldSpace buf_fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,buf_fs);
+    FieldID fidg = field_allocator.allocate_field(sizeof(double), FIELD_GATHERED);
+    assert(fidg == FIELD_GATHERED);
+  }
+  LogicalRegion lr_src = rt->create_logical_region(ctx,is,src_fs);
+  LogicalRegion lr_dst = rt->create_logical_region(ctx,is,dst_fs);
+  LogicalRegion lr_buf = rt->create_logical_region(ctx,is,buf_fs);
+
+  Rect<1> colors(0,num_colors-1);
+  IndexSpace cis = rt->create_index_space(ctx,colors);
+  IndexPartition ip_src = rt->create_equal_partition(ctx, is, cis);
+  LogicalPartition lp_src = rt->get_logical_partition(ctx, lr_src, ip_src);
+  LogicalPartition lp_buf = rt->get_logical_partition(ctx, lr_buf, ip_src);
+
+  TaskLauncher init_launcher(INIT_TASK_ID, TaskArgument(NULL,0));
+  init_launcher.add_region_requirement(RegionRequirement(lr_dst, WRITE_DISCARD, EXCLUSIVE, lr_dst));
+  init_launcher.add_field(0, FIELD_VAL);
+  rt->execute_task(ctx, init_launcher);
+
+  printf("%-8s %12s %12s %16s %16s %14s\n", "pattern", "image ms", "gather ms",
+         "image bounds", "image points", "gather buffer");
+  for (int pattern = PATTERN_LOCAL; pattern <= PATTERN_RANDOM; pattern++)
+    {
+      PtrArgs args;
+      args.n = n;
+      args.pattern = pattern;
+      args.num_colors = num_colors;
+      ArgumentMap arg_map;
+      IndexLauncher ptr_launcher(PTR_TASK_ID, colors, TaskArgument(&args,sizeof(args)), arg_map);
+      ptr_launcher.add_region_requirement(RegionRequirement(lp_src, 0, WRITE_DISCARD, EXCLUSIVE, lr_src));
+      ptr_launcher.region_requirements[0].add_field(FIELD_PTR);
+      rt->execute_index_space(ctx, ptr_launcher);
+
+      double image_us = 0, gather_us = 0;
+      size_t bounds_elements = 0, image_elements = 0;
+      for (int t = 0; t < trials; t++)
+        {
+          FutureMap image_sums, gather_sums;
+          const double i_us = run_image(ctx, rt, is, lr_src, lp_src, lr_dst, cis, colors,
+                                        image_sums, bounds_elements, image_elements);
+          const double g_us = run_gather(ctx, rt, lr_src, lp_src, lr_dst, lr_buf, lp_buf,
+                                         colors, gather_sums);
+          image_us = (t == 0) ? i_us : best_of(image_us, i_us);
+          gather_us = (t == 0) ? g_us : best_of(gather_us, g_us);
+          for (PointInRectIterator<1> itr(colors); itr(); itr++)
+            assert(image_sums.get_result<double>(*itr) == gather_sums.get_result<double>(*itr));
+        }
+      printf("%-8s %12.3f %12.3f %16zu %16zu %14lld\n", pattern_names[pattern],
+             image_us * 1e-3, gather_us * 1e-3, bounds_elements, image_elements, n);
+    }
+
+  rt->destroy_logical_region(ctx,lr_src);
+  rt->destroy_logical_region(ctx,lr_dst);
+  rt->destroy_logical_region(ctx,lr_buf);
+  rt->destroy_field_space(ctx,src_fs);
+  rt->destroy_field_space(ctx,dst_fs);
+  rt->destroy_field_space(ctx,buf_fs);
+  rt->destroy_index_space(ctx,cis);
+  rt->destroy_index_space(ctx,is);
+}
+
+void init_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const FieldAccessor<WRITE_DISCARD,double,1> fa_v(rgns[0], FIELD_VAL);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_v[*itr] = (*itr)[0];
+    }
+}
+
+void ptr_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  const PtrArgs &args = *((const PtrArgs *) task->args);
+  const FieldAccessor<WRITE_DISCARD,Point<1>,1> fa_ptr(rgns[0], FIELD_PTR);
+  Rect<1> d = rt->get_index_space_domain(ctx, task->regions[0].region.get_index_space());
+  const long long n = args.n;
+  const long long half_block = n / args.num_colors / 2;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      const long long i = (*itr)[0];
+      switch (args.pattern)
+        {
+        case PATTERN_LOCAL:   fa_ptr[*itr] = Point<1>(i); break;
+        case PATTERN_SHIFTED: fa_ptr[*itr] = Point<1>((i + half_block) % n); break;
+        // Multiplication by an odd constant modulo a power of two is a permutation
+        case PATTERN_RANDOM:  fa_ptr[*itr] = Point<1>((i * 2654435761LL) % n); break;
+        default: assert(false);
+        }
+    }
+}
+
+double sum_image_task(const Task *task,
+		      const std::vector<PhysicalRegion> &rgns,
+		      Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,Point<1>,1> fa_ptr(rgns[0], FIELD_PTR);
+  const FieldAccessor<READ_ONLY,double,1> fa_v(rgns[1], FIELD_VAL);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_v[fa_ptr[*itr]];
+    }
+  return sum;
+}
+
+double sum_gathered_task(const Task *task,
+			 const std::vector<PhysicalRegion> &rgns,
+			 Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,double,1> fa_g(rgns[0], FIELD_GATHERED);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_g[*itr];
+    }
+  return sum;
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_TASK_ID, "init_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PTR_TASK_ID, "ptr_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<ptr_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_IMAGE_TASK_ID, "sum_image_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_image_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_GATHERED_TASK_ID, "sum_gathered_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_gathered_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -95,16 +95,19 @@ int main(int argc, char **argv)
   {
     TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<top_level_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<sum_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(PTR_TASK_ID, "ptr_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<ptr_task>(registrar);
   }
   return Runtime::start(argc, argv);
@@ -0,0 +1,162 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#include "fast_accessor.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  SUM_GENERIC_1D_TASK_ID,
+  SUM_AFFINE_1D_TASK_ID,
+  SUM_GENERIC_2D_TASK_ID,
+  SUM_AFFINE_2D_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// Stores every sum so the compiler cannot drop the loop when asserts are disabled
+volatile double sum_sink;
+
+//
+// The sum kernel of Regions/physicalregions/physicalregions.cc for a DIM-dimensional
+// region, repeated reps times.  The kernel asserts that every element is 1 and returns
+// the average time per element in nanoseconds.
+//
+template<int DIM, typename ACCESSOR>
+double sum_kernel(const ACCESSOR &fa_a, const Rect<DIM> &d, int reps)
+{
+  const double start = Realm::Clock::current_time_in_nanoseconds();
+  for (int r = 0; r < reps; r++)
+    {
+      double sum = 0;
+      for (PointInRectIterator<DIM> itr(d); itr(); itr++)
+        {
+          sum += fa_a[*itr];
+        }
+      assert(sum == d.volume());
+      sum_sink = sum;
+    }
+  return (Realm::Clock::current_time_in_nanoseconds() - start) / ((double)reps * d.volume());
+}
+
+template<int DIM, bool AFFINE>
+double sum_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const int reps = *((const int *) task->args);
+  Rect<DIM> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  const typename FastAccessor<READ_ONLY,double,DIM,AFFINE>::type fa_a(rgns[0], FIELD_A);
+  return sum_kernel<DIM>(fa_a, d, reps);
+}
+
+template<int DIM>
+double run_sum(Context ctx, Runtime *rt, TaskID tid, LogicalRegion lr, int reps)
+{
+  TaskLauncher sum_launcher(tid, TaskArgument(&reps,sizeof(reps)));
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0, FIELD_A);
+  return rt->execute_task(ctx, sum_launcher).get_result<double>();
+}
+
+template<int DIM>
+void run_region(Context ctx, Runtime *rt, const Rect<DIM> &rec, TaskID generic_tid,
+                TaskID affine_tid, int reps)
+{
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(double), FIELD_A);
+  assert(fida == FIELD_A);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+  double one = 1;
+  rt->fill_field(ctx,lr,lr,fida,&one,sizeof(one));
+
+  const double generic_ns = run_sum<DIM>(ctx, rt, generic_tid, lr, reps);
+  const double affine_ns = run_sum<DIM>(ctx, rt, affine_tid, lr, reps);
+  printf("%dD, %10zu elements: generic %8.3f ns/element  affine %8.3f ns/element  (%.1fx)\n",
+         DIM, rec.volume(), generic_ns, affine_ns, generic_ns / affine_ns);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+//
+// Compares the cost per element of the sum kernel using the generic accessor and
+// using the affine accessor from fast_accessor.h, on a 1D and a 2D region.  Build
+// with NDEBUG to measure the release configuration without bounds checks.
+//
+//  Command line options:
+//    -n N      number of elements in each region
+//    -reps N   number of times each task sums its region
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long n = 1 << 20;
+  int reps = 10;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-reps") && (i+1) < command_args.argc)
+        reps = atoi(command_args.argv[++i]);
+    }
+  printf("Bounds checks are %s\n", FAST_ACCESSOR_CHECK_BOUNDS ? "on" : "off");
+
+  run_region<1>(ctx, rt, Rect<1>(0, n - 1),
+                SUM_GENERIC_1D_TASK_ID, SUM_AFFINE_1D_TASK_ID, reps);
+  long long side = 1;
+  while ((side + 1) * (side + 1) <= n)
+    side++;
+  run_region<2>(ctx, rt, Rect<2>(Point<2>(0,0), Point<2>(side - 1, side - 1)),
+                SUM_GENERIC_2D_TASK_ID, SUM_AFFINE_2D_TASK_ID, reps);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_GENERIC_1D_TASK_ID, "sum_generic_1d_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_task<1,false> >(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_GENERIC_2D_TASK_ID, "sum_generic_2d_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_task<2,false> >(registrar);
+  }
+  // The affine variants may only be given affine instances
+  const LayoutConstraintID affine_layout = preregister_affine_layout();
+  {
+    TaskVariantRegistrar registrar(SUM_AFFINE_1D_TASK_ID, "sum_affine_1d_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.add_layout_constraint_set(0, affine_layout);
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_task<1,true> >(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_AFFINE_2D_TASK_ID, "sum_affine_2d_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.add_layout_constraint_set(0, affine_layout);
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_task<2,true> >(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,10 @@
+#include "fast_accessor.h"
+
+using namespace Legion;
+
+LayoutConstraintID preregister_affine_layout(void)
+{
+  LayoutConstraintRegistrar registrar;
+  registrar.add_constraint(SpecializedConstraint(LEGION_AFFINE_SPECIALIZE));
+  return Runtime::preregister_layout(registrar);
+}
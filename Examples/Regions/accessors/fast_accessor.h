@@ -0,0 +1,48 @@
+#ifndef __FAST_ACCESSOR_H__
+#define __FAST_ACCESSOR_H__
+
+#include <type_traits>
+#include "legion.h"
+
+//
+// Bounds checks are on in debug builds and off in release builds (those compiled
+// with NDEBUG).  Define FAST_ACCESSOR_CHECK_BOUNDS to true or false to override.
+//
+#ifndef FAST_ACCESSOR_CHECK_BOUNDS
+#ifdef NDEBUG
+#define FAST_ACCESSOR_CHECK_BOUNDS false
+#else
+#define FAST_ACCESSOR_CHECK_BOUNDS true
+#endif
+#endif
+
+//
+// The accessor type for a field of type FT in a DIM-dimensional region.  A plain
+// FieldAccessor<PRIV,FT,DIM> goes through Realm's generic accessor, which looks up
+// the layout of the instance on every access.  When AFFINE is true (the default) the
+// type is instead built on Realm's affine accessor, which computes the address of an
+// element directly from the base pointer and strides of the instance; this is only
+// valid for instances with an affine layout, such as those of a task variant
+// registered with the layout from preregister_affine_layout.  Pass AFFINE = false to
+// fall back to the generic accessor for instances with any other layout.
+//
+//   FastAccessor<READ_ONLY,double,2>::type acc(region, FIELD_A);
+//
+template<Legion::PrivilegeMode PRIV, typename FT, int DIM, bool AFFINE = true>
+struct FastAccessor {
+  typedef typename std::conditional<AFFINE,
+                                    Realm::AffineAccessor<FT,DIM,Legion::coord_t>,
+                                    Realm::GenericAccessor<FT,DIM,Legion::coord_t> >::type realm_type;
+  typedef Legion::FieldAccessor<PRIV,FT,DIM,Legion::coord_t,realm_type,
+                                FAST_ACCESSOR_CHECK_BOUNDS> type;
+};
+
+//
+// Register (before Runtime::start) a layout constraint set that requires affine
+// instances, and return its ID.  Adding it to a region requirement of a task variant
+// with TaskVariantRegistrar::add_layout_constraint_set guarantees that the variant
+// only sees affine instances of that region, so it can use FastAccessor safely.
+//
+Legion::LayoutConstraintID preregister_affine_layout(void);
+
+#endif
@@ -0,0 +1,227 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  PRODUCER_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// Spin for the given number of microseconds
+void busy_wait(double us)
+{
+  const double stop = Realm::Clock::current_time_in_microseconds() + us;
+  while (Realm::Clock::current_time_in_microseconds() < stop) ;
+}
+
+// Produce the contents of every region, taking a while to do so
+void launch_producers(Context ctx, Runtime *rt, const std::vector<LogicalRegion> &regions,
+                      double delay_us)
+{
+  for (unsigned i = 0; i < regions.size(); i++)
+    {
+      TaskLauncher producer_launcher(PRODUCER_TASK_ID, TaskArgument(&delay_us,sizeof(delay_us)));
+      producer_launcher.add_region_requirement(
+          RegionRequirement(regions[i], WRITE_DISCARD, EXCLUSIVE, regions[i]));
+      producer_launcher.add_field(0, FIELD_A);
+      rt->execute_task(ctx, producer_launcher);
+    }
+}
+
+InlineLauncher read_launcher(LogicalRegion lr)
+{
+  return InlineLauncher(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr).add_field(0,FIELD_A));
+}
+
+int sum_region(Context ctx, Runtime *rt, PhysicalRegion pr)
+{
+  const FieldAccessor<READ_ONLY,int,1> fa_a(pr, FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx, pr.get_logical_region().get_index_space());
+  int sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_a[*itr];
+    }
+  return sum;
+}
+
+//
+// Map each region in turn and block until it is valid, as in
+// Regions/inlinemapping/inlinemapping.cc, then do the driver's own work.
+//
+double run_blocking(Context ctx, Runtime *rt, const std::vector<LogicalRegion> &regions,
+                    int elements, int work_units, double work_us, double &stall_us)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  stall_us = 0;
+  for (unsigned i = 0; i < regions.size(); i++)
+    {
+      PhysicalRegion pr = rt->map_region(ctx, read_launcher(regions[i]));
+      const double wait_start = Realm::Clock::current_time_in_microseconds();
+      pr.wait_until_valid();
+      stall_us += Realm::Clock::current_time_in_microseconds() - wait_start;
+      int sum = sum_region(ctx, rt, pr);
+      assert(sum == elements);
+      rt->unmap_region(ctx, pr);
+    }
+  for (int w = 0; w < work_units; w++)
+    busy_wait(work_us);
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+// Issue all the inline mappings up front.  While they are being materialized the
+// driver does its own work, checking between units of work for mappings that have
+// become valid and using and unmapping each one as soon as it is ready.
+//
+double run_overlapped(Context ctx, Runtime *rt, const std::vector<LogicalRegion> &regions,
+                      int elements, int work_units, double work_us, double &stall_us)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  stall_us = 0;
+  std::vector<PhysicalRegion> mapped(regions.size());
+  for (unsigned i = 0; i < regions.size(); i++)
+    mapped[i] = rt->map_region(ctx, read_launcher(regions[i]));
+  std::vector<bool> done(regions.size(), false);
+  unsigned remaining = regions.size();
+  int w = 0;
+  while (remaining > 0)
+    {
+      bool progress = false;
+      for (unsigned i = 0; i < mapped.size(); i++)
+        {
+          if (done[i] || !mapped[i].is_valid())
+            continue;
+          int sum = sum_region(ctx, rt, mapped[i]);
+          assert(sum == elements);
+          rt->unmap_region(ctx, mapped[i]);
+          done[i] = true;
+          remaining--;
+          progress = true;
+        }
+      if (progress || (remaining == 0))
+        continue;
+      if (w < work_units)
+        {
+          busy_wait(work_us);
+          w++;
+        }
+      else
+        {
+          // Out of work to overlap with: block on the first region that is not ready
+          for (unsigned i = 0; i < mapped.size(); i++)
+            if (!done[i])
+              {
+                const double wait_start = Realm::Clock::current_time_in_microseconds();
+                mapped[i].wait_until_valid();
+                stall_us += Realm::Clock::current_time_in_microseconds() - wait_start;
+                break;
+              }
+        }
+    }
+  for ( ; w < work_units; w++)
+    busy_wait(work_us);
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+//  The producers need a processor of their own while the driver works, so run
+//  with at least two CPUs (-ll:cpu 2).
+//
+//  Command line options:
+//    -regions N   number of regions mapped by the driver
+//    -n N         elements per region
+//    -delay US    time each producer task takes to produce its region
+//    -work N      units of the driver's own work
+//    -unit US     length of one unit of work
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int num_regions = 8;
+  int elements = 100;
+  double delay_us = 2000;
+  int work_units = 100;
+  double work_us = 100;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-regions") && (i+1) < command_args.argc)
+        num_regions = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        elements = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-delay") && (i+1) < command_args.argc)
+        delay_us = atof(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-work") && (i+1) < command_args.argc)
+        work_units = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-unit") && (i+1) < command_args.argc)
+        work_us = atof(command_args.argv[++i]);
+    }
+
+  Rect<1> rec(Point<1>(0),Point<1>(elements - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+
+  std::vector<LogicalRegion> regions;
+  for (int i = 0; i < num_regions; i++)
+    regions.push_back(rt->create_logical_region(ctx,is,fs));
+
+  double blocking_stall, overlapped_stall;
+  launch_producers(ctx, rt, regions, delay_us);
+  const double blocking = run_blocking(ctx, rt, regions, elements,
+                                       work_units, work_us, blocking_stall);
+  launch_producers(ctx, rt, regions, delay_us);
+  const double overlapped = run_overlapped(ctx, rt, regions, elements,
+                                           work_units, work_us, overlapped_stall);
+
+  printf("blocking:   %10.3f ms, %10.3f ms stalled\n", blocking * 1e-3, blocking_stall * 1e-3);
+  printf("overlapped: %10.3f ms, %10.3f ms stalled\n", overlapped * 1e-3, overlapped_stall * 1e-3);
+  printf("latency hidden: %10.3f ms\n", (blocking - overlapped) * 1e-3);
+
+  for (int i = 0; i < num_regions; i++)
+    rt->destroy_logical_region(ctx,regions[i]);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+void producer_task(const Task *task,
+		   const std::vector<PhysicalRegion> &rgns,
+		   Context ctx, Runtime *rt)
+{
+  busy_wait(*((const double *) task->args));
+  const FieldAccessor<WRITE_DISCARD,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx, task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PRODUCER_TASK_ID, "producer_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<producer_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
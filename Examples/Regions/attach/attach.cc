@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "legion.h"
+#include "mapped_file.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  SUM_TASK_ID,
+  SCALE_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// Write a file of n doubles holding 0, 1, ..., n-1
+void generate_file(const char *file_name, long long n)
+{
+  FILE *f = fopen(file_name, "wb");
+  assert(f != NULL);
+  std::vector<double> chunk(1 << 16);
+  for (long long i = 0; i < n; i += chunk.size())
+    {
+      size_t count = std::min((long long)chunk.size(), n - i);
+      for (size_t j = 0; j < count; j++)
+        chunk[j] = i + j;
+      size_t written = fwrite(chunk.data(), sizeof(double), count, f);
+      assert(written == count);
+    }
+  fclose(f);
+}
+
+// Check that the file holds 0, 2, ..., 2(n-1), the result of one scale task
+void check_file(const char *file_name, long long n)
+{
+  FILE *f = fopen(file_name, "rb");
+  assert(f != NULL);
+  std::vector<double> chunk(1 << 16);
+  for (long long i = 0; i < n; i += chunk.size())
+    {
+      size_t count = std::min((long long)chunk.size(), n - i);
+      size_t read = fread(chunk.data(), sizeof(double), count, f);
+      assert(read == count);
+      for (size_t j = 0; j < count; j++)
+        assert(chunk[j] == 2.0 * (i + j));
+    }
+  fclose(f);
+}
+
+double sum_region(Context ctx, Runtime *rt, LogicalRegion lr)
+{
+  TaskLauncher sum_launcher(SUM_TASK_ID, TaskArgument(NULL,0));
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0, FIELD_A);
+  return rt->execute_task(ctx, sum_launcher).get_result<double>();
+}
+
+void scale_region(Context ctx, Runtime *rt, LogicalRegion lr)
+{
+  TaskLauncher scale_launcher(SCALE_TASK_ID, TaskArgument(NULL,0));
+  scale_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, EXCLUSIVE, lr));
+  scale_launcher.add_field(0, FIELD_A);
+  rt->execute_task(ctx, scale_launcher);
+}
+
+//
+// The approach of Regions/inlinemapping: read the file into a buffer, copy the buffer
+// into an inline mapping element by element, and do the reverse to write it back.
+//
+void run_copy(Context ctx, Runtime *rt, LogicalRegion lr, const char *file_name, long long n)
+{
+  const Rect<1> rec(0, n - 1);
+  const double start = Realm::Clock::current_time_in_microseconds();
+  {
+    std::vector<double> buffer(n);
+    FILE *f = fopen(file_name, "rb");
+    assert(f != NULL);
+    size_t read = fread(buffer.data(), sizeof(double), n, f);
+    assert(read == (size_t)n);
+    fclose(f);
+    InlineLauncher launcher(RegionRequirement(lr, WRITE_DISCARD, EXCLUSIVE, lr).add_field(0,FIELD_A));
+    PhysicalRegion pr = rt->map_region(ctx, launcher);
+    pr.wait_until_valid();
+    const FieldAccessor<WRITE_DISCARD,double,1> fa_a(pr, FIELD_A);
+    for (PointInRectIterator<1> itr(rec); itr(); itr++)
+      fa_a[*itr] = buffer[(*itr)[0]];
+    rt->unmap_region(ctx, pr);
+  }
+  const double loaded = Realm::Clock::current_time_in_microseconds();
+  double sum = sum_region(ctx, rt, lr);
+  assert(sum == 0.5 * n * (n - 1));
+  scale_region(ctx, rt, lr);
+  const double computed = Realm::Clock::current_time_in_microseconds();
+  {
+    std::vector<double> buffer(n);
+    InlineLauncher launcher(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr).add_field(0,FIELD_A));
+    PhysicalRegion pr = rt->map_region(ctx, launcher);
+    pr.wait_until_valid();
+    const FieldAccessor<READ_ONLY,double,1> fa_a(pr, FIELD_A);
+    for (PointInRectIterator<1> itr(rec); itr(); itr++)
+      buffer[(*itr)[0]] = fa_a[*itr];
+    rt->unmap_region(ctx, pr);
+    FILE *f = fopen(file_name, "r+b");
+    assert(f != NULL);
+    size_t written = fwrite(buffer.data(), sizeof(double), n, f);
+    assert(written == (size_t)n);
+    fclose(f);
+  }
+  const double stored = Realm::Clock::current_time_in_microseconds();
+  printf("copy:   load %10.3f ms  compute %10.3f ms  store %10.3f ms  total %10.3f ms\n",
+         (loaded - start) * 1e-3, (computed - loaded) * 1e-3,
+         (stored - computed) * 1e-3, (stored - start) * 1e-3);
+}
+
+//
+// Attach the memory-mapped file to the region, run the same tasks on it directly,
+// and detach to write the results back.
+//
+void run_attach(Context ctx, Runtime *rt, LogicalRegion lr, const char *file_name, long long n)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  MappedFile file = attach_mapped_file(ctx, rt, lr, FIELD_A, sizeof(double),
+                                       file_name, true/*writable*/);
+  const double loaded = Realm::Clock::current_time_in_microseconds();
+  double sum = sum_region(ctx, rt, lr);
+  assert(sum == 0.5 * n * (n - 1));
+  scale_region(ctx, rt, lr);
+  const double computed = Realm::Clock::current_time_in_microseconds();
+  detach_mapped_file(ctx, rt, file);
+  const double stored = Realm::Clock::current_time_in_microseconds();
+  printf("attach: load %10.3f ms  compute %10.3f ms  store %10.3f ms  total %10.3f ms\n",
+         (loaded - start) * 1e-3, (computed - loaded) * 1e-3,
+         (stored - computed) * 1e-3, (stored - start) * 1e-3);
+}
+
+//
+//  Command line options:
+//    -n N        number of doubles in the file
+//    -file NAME  path of the data file, which is created and removed by the example
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long n = 1 << 20;
+  const char *file_name = "attach_data.bin";
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-file") && (i+1) < command_args.argc)
+        file_name = command_args.argv[++i];
+    }
+  assert(n > 0);
+  printf("File of %lld doubles (%.1f MB)\n", n, n * sizeof(double) / 1048576.0);
+
+  Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(double), FIELD_A);
+  assert(fida == FIELD_A);
+
+  // Use a fresh region for each approach so neither benefits from instances made by the other
+  LogicalRegion lr_copy = rt->create_logical_region(ctx,is,fs);
+  generate_file(file_name, n);
+  run_copy(ctx, rt, lr_copy, file_name, n);
+  check_file(file_name, n);
+
+  LogicalRegion lr_attach = rt->create_logical_region(ctx,is,fs);
+  generate_file(file_name, n);
+  run_attach(ctx, rt, lr_attach, file_name, n);
+  check_file(file_name, n);
+  remove(file_name);
+
+  rt->destroy_logical_region(ctx,lr_copy);
+  rt->destroy_logical_region(ctx,lr_attach);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+double sum_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,double,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_a[*itr];
+    }
+  return sum;
+}
+
+void scale_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_WRITE,double,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = 2.0 * fa_a[*itr];
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SCALE_TASK_ID, "scale_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<scale_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_file.h"
+
+using namespace Legion;
+
+MappedFile attach_mapped_file(Context ctx, Runtime *runtime,
+                              LogicalRegion lr, FieldID fid,
+                              size_t field_size, const char *file_name, bool writable)
+{
+  MappedFile file;
+  file.writable = writable;
+  Domain domain = runtime->get_index_space_domain(ctx, lr.get_index_space());
+  assert(domain.dense());
+  file.bytes = domain.get_volume() * field_size;
+
+  file.fd = open(file_name, writable ? O_RDWR : O_RDONLY);
+  if (file.fd < 0)
+    {
+      perror(file_name);
+      abort();
+    }
+  struct stat info;
+  if ((fstat(file.fd, &info) != 0) || ((size_t)info.st_size < file.bytes))
+    {
+      fprintf(stderr, "%s holds fewer than %zu bytes\n", file_name, file.bytes);
+      abort();
+    }
+  file.base = mmap(NULL, file.bytes, PROT_READ | PROT_WRITE,
+                   writable ? MAP_SHARED : MAP_PRIVATE, file.fd, 0);
+  if (file.base == MAP_FAILED)
+    {
+      perror("mmap");
+      abort();
+    }
+
+  // The mapped pages live in ordinary host memory, so the instance belongs to the
+  // system memory of the processor doing the attach
+  Machine::MemoryQuery mem_query(Machine::get_machine());
+  mem_query.only_kind(Memory::SYSTEM_MEM);
+  mem_query.has_affinity_to(runtime->get_executing_processor(ctx));
+  Memory sysmem = mem_query.first();
+  assert(sysmem.exists());
+
+  AttachLauncher launcher(LEGION_EXTERNAL_INSTANCE, lr, lr);
+  std::vector<FieldID> fields(1, fid);
+  launcher.attach_array_soa(file.base, true/*column major*/, fields, sysmem);
+  file.region = runtime->attach_external_resource(ctx, launcher);
+  return file;
+}
+
+void detach_mapped_file(Context ctx, Runtime *runtime, MappedFile &file)
+{
+  runtime->detach_external_resource(ctx, file.region).get_void_result();
+  if (file.writable)
+    msync(file.base, file.bytes, MS_SYNC);
+  munmap(file.base, file.bytes);
+  close(file.fd);
+  file.base = NULL;
+  file.fd = -1;
+}
@@ -0,0 +1,36 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include "legion.h"
+
+//
+// A binary file attached to one field of a logical region.  The file is memory-mapped
+// and the mapping is attached to the region as an external instance, so tasks using
+// the region read and write the pages of the file directly: nothing is copied through
+// the task that attaches the file and no second copy of the data is allocated.
+//
+struct MappedFile {
+  Legion::PhysicalRegion region;
+  void *base;
+  size_t bytes;
+  int fd;
+  bool writable;
+};
+
+//
+// Attach the file to field fid of lr.  The file must start with one element of
+// field_size bytes for each point of the (dense) index space of lr, stored in
+// column-major order.  If writable is false the file is mapped copy-on-write:
+// tasks may still write the region, but their writes never reach the file.
+//
+MappedFile attach_mapped_file(Legion::Context ctx, Legion::Runtime *runtime,
+                              Legion::LogicalRegion lr, Legion::FieldID fid,
+                              size_t field_size, const char *file_name, bool writable);
+
+//
+// Detach the file, wait for all the tasks using the region to finish and for any
+// writes to reach the file, and unmap it.
+//
+void detach_mapped_file(Legion::Context ctx, Legion::Runtime *runtime, MappedFile &file);
+
+#endif // __MAPPED_FILE_H__
@@ -0,0 +1,243 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INIT_TASK_ID,
+  CHECK_TASK_ID,
+};
+
+// One field of each size; the field ID is the index into field_sizes
+static const int field_sizes[] = { 4, 8, 16, 32, 64 };
+static const int num_field_sizes = sizeof(field_sizes) / sizeof(field_sizes[0]);
+
+template<int BYTES>
+struct Element {
+  unsigned char bytes[BYTES];
+};
+
+// Which field an init or check task works on and the byte every element should hold
+struct FieldArgs {
+  FieldID fid;
+  int bytes;
+  unsigned char value;
+};
+
+template<int BYTES>
+void init_field(const PhysicalRegion &pr, FieldID fid, const Rect<1> &d, unsigned char value)
+{
+  const FieldAccessor<WRITE_DISCARD,Element<BYTES>,1> fa(pr, fid);
+  Element<BYTES> element;
+  memset(element.bytes, value, BYTES);
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa[*itr] = element;
+    }
+}
+
+template<int BYTES>
+void check_field(const PhysicalRegion &pr, FieldID fid, const Rect<1> &d, unsigned char value)
+{
+  const FieldAccessor<READ_ONLY,Element<BYTES>,1> fa(pr, fid);
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      const Element<BYTES> element = fa[*itr];
+      for (int b = 0; b < BYTES; b++)
+        assert(element.bytes[b] == value);
+    }
+}
+
+// Launch an init or check task on every subregion
+void launch(Context ctx, Runtime *rt, TaskID tid, PrivilegeMode priv, const Rect<1> &colors,
+            LogicalPartition lp, LogicalRegion lr, const FieldArgs &args)
+{
+  ArgumentMap arg_map;
+  IndexLauncher launcher(tid, colors, TaskArgument(&args,sizeof(args)), arg_map);
+  launcher.add_region_requirement(RegionRequirement(lp, 0, priv, EXCLUSIVE, lr));
+  launcher.region_requirements[0].add_field(args.fid);
+  rt->execute_index_space(ctx, launcher);
+}
+
+double elapsed_ms(Context ctx, Runtime *rt, double start)
+{
+  rt->issue_execution_fence(ctx).get_void_result();
+  return (Realm::Clock::current_time_in_microseconds() - start) * 1e-3;
+}
+
+//
+// Compares three ways of initializing a field, each followed by a task that reads
+// the whole field, for several region sizes and field sizes:
+//
+//   fill        a single fill_field on the whole region, as in Regions/fillfields
+//   indexfill   an IndexFillLauncher over an equal partition of the region
+//   init        an index launch of a task that writes every element, as in
+//               Regions/physicalregions
+//
+// A fill is deferred until some task needs the data, so a fill followed by a task
+// that discards the field (WRITE_DISCARD) should cost no more than the task alone;
+// the column "fill+discard" measures exactly that sequence.
+//
+//  Command line options:
+//    -min N       smallest number of elements in the region
+//    -max N       largest number of elements in the region (sizes grow by 16x)
+//    -colors N    number of subregions used by the index fill and the tasks
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long min_elements = 1 << 10;
+  long long max_elements = 1 << 18;
+  int num_colors = 4;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-min") && (i+1) < command_args.argc)
+        min_elements = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_elements = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        num_colors = atoi(command_args.argv[++i]);
+    }
+
+  FieldSpace fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+    for (int f = 0; f < num_field_sizes; f++)
+      {
+        FieldID fid = field_allocator.allocate_field(field_sizes[f], f);
+        assert(fid == (FieldID)f);
+      }
+  }
+  Rect<1> colors(0,num_colors - 1);
+  IndexSpace color_is = rt->create_index_space(ctx, colors);
+
+  printf("%12s %6s %12s %12s %12s %14s\n", "elements", "bytes",
+         "fill ms", "indexfill ms", "init ms", "fill+discard");
+  for (long long n = min_elements; n <= max_elements; n *= 16)
+    {
+      Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+      IndexSpace is = rt->create_index_space(ctx,rec);
+      IndexPartition ip = rt->create_equal_partition(ctx, is, color_is);
+      LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+      LogicalPartition lp = rt->get_logical_partition(ctx, lr, ip);
+
+      for (int f = 0; f < num_field_sizes; f++)
+        {
+          FieldArgs args;
+          args.fid = f;
+          args.bytes = field_sizes[f];
+          std::vector<unsigned char> value(args.bytes);
+
+          // Warm up so every variant finds the instances already created
+          args.value = 1;
+          launch(ctx, rt, INIT_TASK_ID, WRITE_DISCARD, colors, lp, lr, args);
+          launch(ctx, rt, CHECK_TASK_ID, READ_ONLY, colors, lp, lr, args);
+          rt->issue_execution_fence(ctx).get_void_result();
+
+          args.value = 2;
+          memset(value.data(), args.value, args.bytes);
+          double start = Realm::Clock::current_time_in_microseconds();
+          rt->fill_field(ctx, lr, lr, args.fid, value.data(), args.bytes);
+          launch(ctx, rt, CHECK_TASK_ID, READ_ONLY, colors, lp, lr, args);
+          const double fill_ms = elapsed_ms(ctx, rt, start);
+
+          args.value = 3;
+          memset(value.data(), args.value, args.bytes);
+          start = Realm::Clock::current_time_in_microseconds();
+          IndexFillLauncher fill_launcher(colors, lp, lr, TaskArgument(value.data(), args.bytes));
+          fill_launcher.add_field(args.fid);
+          rt->fill_fields(ctx, fill_launcher);
+          launch(ctx, rt, CHECK_TASK_ID, READ_ONLY, colors, lp, lr, args);
+          const double index_fill_ms = elapsed_ms(ctx, rt, start);
+
+          args.value = 4;
+          start = Realm::Clock::current_time_in_microseconds();
+          launch(ctx, rt, INIT_TASK_ID, WRITE_DISCARD, colors, lp, lr, args);
+          launch(ctx, rt, CHECK_TASK_ID, READ_ONLY, colors, lp, lr, args);
+          const double init_ms = elapsed_ms(ctx, rt, start);
+
+          // The fill is never observed, so it should never be materialized
+          args.value = 5;
+          memset(value.data(), 6, args.bytes);
+          start = Realm::Clock::current_time_in_microseconds();
+          rt->fill_field(ctx, lr, lr, args.fid, value.data(), args.bytes);
+          launch(ctx, rt, INIT_TASK_ID, WRITE_DISCARD, colors, lp, lr, args);
+          launch(ctx, rt, CHECK_TASK_ID, READ_ONLY, colors, lp, lr, args);
+          const double discard_ms = elapsed_ms(ctx, rt, start);
+
+          printf("%12lld %6d %12.3f %12.3f %12.3f %14.3f\n", n, args.bytes,
+                 fill_ms, index_fill_ms, init_ms, discard_ms);
+        }
+
+      rt->destroy_logical_region(ctx,lr);
+      rt->destroy_index_partition(ctx,ip);
+      rt->destroy_index_space(ctx,is);
+    }
+
+  rt->destroy_index_space(ctx,color_is);
+  rt->destroy_field_space(ctx,fs);
+}
+
+void init_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const FieldArgs &args = *((const FieldArgs *) task->args);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  switch (args.bytes)
+    {
+    case 4:  init_field<4>(rgns[0], args.fid, d, args.value); break;
+    case 8:  init_field<8>(rgns[0], args.fid, d, args.value); break;
+    case 16: init_field<16>(rgns[0], args.fid, d, args.value); break;
+    case 32: init_field<32>(rgns[0], args.fid, d, args.value); break;
+    case 64: init_field<64>(rgns[0], args.fid, d, args.value); break;
+    default: assert(false);
+    }
+}
+
+void check_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const FieldArgs &args = *((const FieldArgs *) task->args);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  switch (args.bytes)
+    {
+    case 4:  check_field<4>(rgns[0], args.fid, d, args.value); break;
+    case 8:  check_field<8>(rgns[0], args.fid, d, args.value); break;
+    case 16: check_field<16>(rgns[0], args.fid, d, args.value); break;
+    case 32: check_field<32>(rgns[0], args.fid, d, args.value); break;
+    case 64: check_field<64>(rgns[0], args.fid, d, args.value); break;
+    default: assert(false);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_TASK_ID, "init_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CHECK_TASK_ID, "check_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<check_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  TOUCH_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+// Resident set size of this process in megabytes, or 0 where /proc is not available
+double resident_mb(void)
+{
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == NULL)
+    return 0;
+  long pages = 0, resident = 0;
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+    resident = 0;
+  fclose(f);
+  return resident * (double)sysconf(_SC_PAGESIZE) / 1048576.0;
+}
+
+//
+// Stress test for the creation and destruction of region tree objects.  Each step
+// creates many temporary index spaces, field spaces and logical regions, as adaptive
+// codes do, optionally runs a task on each region so that it gets a physical instance,
+// and then destroys all of them.  The time per step and the resident memory of the
+// process after each step are printed, so a leak or slow reclamation shows up as a
+// falling rate or a growing resident size.
+//
+//  Command line options:
+//    -steps N     number of steps
+//    -regions N   number of temporary regions created and destroyed per step
+//    -n N         number of elements in each region
+//    -touch       run a task on every temporary region before it is destroyed
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int steps = 20;
+  int num_regions = 100;
+  int elements = 100;
+  bool touch = false;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-steps") && (i+1) < command_args.argc)
+        steps = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-regions") && (i+1) < command_args.argc)
+        num_regions = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        elements = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-touch"))
+        touch = true;
+    }
+
+  std::vector<IndexSpace> index_spaces(num_regions);
+  std::vector<FieldSpace> field_spaces(num_regions);
+  std::vector<LogicalRegion> regions(num_regions);
+  printf("%6s %12s %14s %12s\n", "step", "ms", "regions/s", "RSS MB");
+  printf("%6s %12s %14s %12.1f\n", "start", "", "", resident_mb());
+  for (int step = 0; step < steps; step++)
+    {
+      const double start = Realm::Clock::current_time_in_microseconds();
+      for (int r = 0; r < num_regions; r++)
+        {
+          // Vary the size a little so the runtime cannot simply reuse identical objects
+          Rect<1> rec(Point<1>(0),Point<1>(elements - 1 + (r % 4)));
+          index_spaces[r] = rt->create_index_space(ctx,rec);
+          field_spaces[r] = rt->create_field_space(ctx);
+          FieldAllocator field_allocator = rt->create_field_allocator(ctx,field_spaces[r]);
+          FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+          assert(fida == FIELD_A);
+          regions[r] = rt->create_logical_region(ctx,index_spaces[r],field_spaces[r]);
+        }
+      if (touch)
+        for (int r = 0; r < num_regions; r++)
+          {
+            TaskLauncher touch_launcher(TOUCH_TASK_ID, TaskArgument(NULL,0));
+            touch_launcher.add_region_requirement(
+                RegionRequirement(regions[r], WRITE_DISCARD, EXCLUSIVE, regions[r]));
+            touch_launcher.add_field(0, FIELD_A);
+            rt->execute_task(ctx, touch_launcher);
+          }
+      for (int r = 0; r < num_regions; r++)
+        {
+          rt->destroy_logical_region(ctx,regions[r]);
+          rt->destroy_field_space(ctx,field_spaces[r]);
+          rt->destroy_index_space(ctx,index_spaces[r]);
+        }
+      rt->issue_execution_fence(ctx).get_void_result();
+      const double stop = Realm::Clock::current_time_in_microseconds();
+      printf("%6d %12.3f %14.1f %12.1f\n", step, (stop - start) * 1e-3,
+             num_regions / ((stop - start) * 1e-6), resident_mb());
+    }
+}
+
+void touch_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const FieldAccessor<WRITE_DISCARD,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = (*itr)[0];
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(TOUCH_TASK_ID, "touch_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<touch_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,444 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INIT_TASK_ID,
+  PTR_TASK_ID,
+  CHECK_TASK_ID,
+};
+
+// The data fields are FIELD_DATA, FIELD_DATA + 1, ...; the indirection field is in its own region
+enum FieldIDs {
+  FIELD_PTR,
+  FIELD_DATA,
+};
+
+enum CheckModes {
+  CHECK_DIRECT,
+  CHECK_GATHER,
+  CHECK_SCATTER,
+};
+
+struct CheckArgs {
+  int mode;
+  int num_fields;
+};
+
+//
+// Copies launched with a tag made by copy_tag have their source instances placed in
+// one kind of memory and their destination instances in another.  Untagged copies are
+// mapped as the default mapper would.
+//
+static const MappingTagID PLACE_COPY_TAG = 1 << 16;
+
+MappingTagID copy_tag(Memory::Kind src_kind, Memory::Kind dst_kind)
+{
+  return PLACE_COPY_TAG | (src_kind << 8) | dst_kind;
+}
+
+const char *memory_name(Memory::Kind kind)
+{
+  switch (kind)
+    {
+    case Memory::SYSTEM_MEM: return "sysmem";
+    case Memory::REGDMA_MEM: return "regmem";
+    case Memory::SOCKET_MEM: return "numamem";
+    case Memory::Z_COPY_MEM: return "zcmem";
+    default: return "other";
+    }
+}
+
+class CopyMapper : public DefaultMapper {
+public:
+  CopyMapper(MapperRuntime *rt, Machine m, Processor p)
+    : DefaultMapper(rt, m, p, "copy_mapper") { }
+public:
+  virtual void map_copy(const MapperContext ctx,
+                        const Copy &copy,
+                        const MapCopyInput &input,
+                        MapCopyOutput &output);
+public:
+  static void register_copy_mappers(Machine machine, Runtime *rt,
+                                    const std::set<Processor> &local_procs);
+protected:
+  PhysicalInstance place_instance(const MapperContext ctx, Memory::Kind kind,
+                                  const RegionRequirement &req);
+};
+
+PhysicalInstance CopyMapper::place_instance(const MapperContext ctx, Memory::Kind kind,
+                                            const RegionRequirement &req)
+{
+  Machine::MemoryQuery mem_query(machine);
+  mem_query.only_kind(kind);
+  mem_query.has_affinity_to(local_proc);
+  Memory target = mem_query.first();
+  assert(target.exists());
+
+  // A struct-of-arrays instance holding exactly the fields of the requirement
+  LayoutConstraintSet constraints;
+  std::vector<FieldID> fields(req.privilege_fields.begin(), req.privilege_fields.end());
+  constraints.add_constraint(FieldConstraint(fields, false/*contiguous*/, false/*inorder*/));
+  std::vector<DimensionKind> ordering;
+  ordering.push_back(LEGION_DIM_X);
+  ordering.push_back(LEGION_DIM_F);
+  constraints.add_constraint(OrderingConstraint(ordering, false/*contiguous*/));
+
+  std::vector<LogicalRegion> regions(1, req.region);
+  PhysicalInstance result;
+  bool created;
+  if (!runtime->find_or_create_physical_instance(ctx, target, constraints, regions,
+                                                 result, created))
+    {
+      printf("Failed to allocate an instance in %s; is the memory large enough?\n",
+             memory_name(kind));
+      assert(false);
+    }
+  return result;
+}
+
+void CopyMapper::map_copy(const MapperContext ctx,
+                          const Copy &copy,
+                          const MapCopyInput &input,
+                          MapCopyOutput &output)
+{
+  DefaultMapper::map_copy(ctx, copy, input, output);
+  if (!(copy.tag & PLACE_COPY_TAG))
+    return;
+  const Memory::Kind src_kind = (Memory::Kind)((copy.tag >> 8) & 0xff);
+  const Memory::Kind dst_kind = (Memory::Kind)(copy.tag & 0xff);
+  for (unsigned idx = 0; idx < copy.src_requirements.size(); idx++)
+    {
+      output.src_instances[idx].clear();
+      output.src_instances[idx].push_back(place_instance(ctx, src_kind, copy.src_requirements[idx]));
+    }
+  for (unsigned idx = 0; idx < copy.dst_requirements.size(); idx++)
+    {
+      output.dst_instances[idx].clear();
+      output.dst_instances[idx].push_back(place_instance(ctx, dst_kind, copy.dst_requirements[idx]));
+    }
+}
+
+/*static*/
+void CopyMapper::register_copy_mappers(Machine machine, Runtime *rt,
+                                       const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new CopyMapper(map_rt, machine, *it), *it);
+    }
+}
+
+struct CopyRegions {
+  LogicalRegion src, dst, idx;
+  LogicalPartition src_lp, dst_lp;
+  Rect<1> colors;
+  int num_fields;
+};
+
+void add_data_fields(RegionRequirement &req, int num_fields)
+{
+  for (int f = 0; f < num_fields; f++)
+    req.add_field(FIELD_DATA + f);
+}
+
+void check(Context ctx, Runtime *rt, const CopyRegions &r, int mode)
+{
+  CheckArgs args;
+  args.mode = mode;
+  args.num_fields = r.num_fields;
+  TaskLauncher check_launcher(CHECK_TASK_ID, TaskArgument(&args,sizeof(args)));
+  check_launcher.add_region_requirement(RegionRequirement(r.dst, READ_ONLY, EXCLUSIVE, r.dst));
+  add_data_fields(check_launcher.region_requirements[0], r.num_fields);
+  check_launcher.add_region_requirement(RegionRequirement(r.idx, READ_ONLY, EXCLUSIVE, r.idx));
+  check_launcher.add_field(1, FIELD_PTR);
+  rt->execute_task(ctx, check_launcher).get_void_result();
+  // Clear the destination so the next copy cannot pass the check by accident
+  double zero = 0;
+  FillLauncher fill_launcher(r.dst, r.dst, TaskArgument(&zero,sizeof(zero)));
+  for (int f = 0; f < r.num_fields; f++)
+    fill_launcher.add_field(FIELD_DATA + f);
+  rt->fill_fields(ctx, fill_launcher);
+}
+
+//
+// Issue one copy of every data field from src to dst, optionally as an index copy over
+// the partitions or through the indirection field, and return the time it took.
+//
+double timed_copy(Context ctx, Runtime *rt, const CopyRegions &r, MappingTagID tag,
+                  bool index, int mode)
+{
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  if (index)
+    {
+      IndexCopyLauncher copy_launcher(r.colors);
+      copy_launcher.add_copy_requirements(
+          RegionRequirement(r.src_lp, 0, READ_ONLY, EXCLUSIVE, r.src),
+          RegionRequirement(r.dst_lp, 0, WRITE_DISCARD, EXCLUSIVE, r.dst));
+      add_data_fields(copy_launcher.src_requirements[0], r.num_fields);
+      add_data_fields(copy_launcher.dst_requirements[0], r.num_fields);
+      copy_launcher.tag = tag;
+      rt->issue_copy_operation(ctx, copy_launcher);
+    }
+  else
+    {
+      CopyLauncher copy_launcher;
+      copy_launcher.add_copy_requirements(
+          RegionRequirement(r.src, READ_ONLY, EXCLUSIVE, r.src),
+          RegionRequirement(r.dst, (mode == CHECK_SCATTER) ? READ_WRITE : WRITE_DISCARD,
+                            EXCLUSIVE, r.dst));
+      add_data_fields(copy_launcher.src_requirements[0], r.num_fields);
+      add_data_fields(copy_launcher.dst_requirements[0], r.num_fields);
+      if (mode == CHECK_GATHER)
+        copy_launcher.add_src_indirect_field(FIELD_PTR,
+            RegionRequirement(r.idx, READ_ONLY, EXCLUSIVE, r.idx));
+      else if (mode == CHECK_SCATTER)
+        copy_launcher.add_dst_indirect_field(FIELD_PTR,
+            RegionRequirement(r.idx, READ_ONLY, EXCLUSIVE, r.idx));
+      copy_launcher.tag = tag;
+      rt->issue_copy_operation(ctx, copy_launcher);
+    }
+  rt->issue_execution_fence(ctx).get_void_result();
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+// Best bandwidth in GB/s over several trials, after a first copy that creates the instances
+double bandwidth(Context ctx, Runtime *rt, const CopyRegions &r, MappingTagID tag,
+                 bool index, int mode, long long n, int trials)
+{
+  timed_copy(ctx, rt, r, tag, index, mode);
+  check(ctx, rt, r, mode);
+  double best = 0;
+  for (int t = 0; t < trials; t++)
+    {
+      const double us = timed_copy(ctx, rt, r, tag, index, mode);
+      const double gbs = n * r.num_fields * sizeof(double) / (us * 1e3);
+      if (gbs > best)
+        best = gbs;
+    }
+  return best;
+}
+
+//
+// Measures the bandwidth of explicit copies between two regions.  Plain and index
+// copies are timed for every pair of the CPU-visible memories present on the node
+// (system memory always, registered memory with -ll:rsize, NUMA memory with
+// -ll:nsize), and gather and scatter copies through an indirection field like the
+// FIELD_PTR of Partitions/image/image.cc are timed in system memory.
+//
+//  Command line options:
+//    -min N      smallest number of elements per region, a power of two
+//    -max N      largest number of elements per region (sizes grow by 16x)
+//    -fields N   largest number of fields copied (the counts used are 1, 2, 4, ..., N)
+//    -stride S   the indirection field holds i*S mod n; S must be odd
+//    -colors N   number of subregions for index copies
+//    -trials N   number of timed copies per measurement
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long min_elements = 1 << 16;
+  long long max_elements = 1 << 20;
+  int max_fields = 4;
+  long long stride = 7919;
+  int num_colors = 4;
+  int trials = 3;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-min") && (i+1) < command_args.argc)
+        min_elements = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_elements = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-fields") && (i+1) < command_args.argc)
+        max_fields = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-stride") && (i+1) < command_args.argc)
+        stride = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        num_colors = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-trials") && (i+1) < command_args.argc)
+        trials = atoi(command_args.argv[++i]);
+    }
+  // i*stride mod n is only a permutation when the stride is odd and n is a power of two;
+  // the sizes used are then all powers of two
+  assert((stride % 2) == 1);
+  assert((min_elements & (min_elements - 1)) == 0);
+
+  std::vector<Memory::Kind> kinds;
+  const Memory::Kind candidates[] = { Memory::SYSTEM_MEM, Memory::REGDMA_MEM, Memory::SOCKET_MEM };
+  for (unsigned k = 0; k < sizeof(candidates) / sizeof(candidates[0]); k++)
+    {
+      Machine::MemoryQuery mem_query(Machine::get_machine());
+      mem_query.only_kind(candidates[k]);
+      mem_query.has_affinity_to(task->current_proc);
+      if (mem_query.count() > 0)
+        kinds.push_back(candidates[k]);
+    }
+
+  FieldSpace fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+    for (int f = 0; f < max_fields; f++)
+      field_allocator.allocate_field(sizeof(double), FIELD_DATA + f);
+  }
+  FieldSpace idx_fs = rt->create_field_space(ctx);
+  {
+    FieldAllocator field_allocator = rt->create_field_allocator(ctx,idx_fs);
+    FieldID fidptr = field_allocator.allocate_field(sizeof(Point<1>), FIELD_PTR);
+    assert(fidptr == FIELD_PTR);
+  }
+  CopyRegions r;
+  r.colors = Rect<1>(0, num_colors - 1);
+  IndexSpace color_is = rt->create_index_space(ctx, r.colors);
+
+  printf("%-8s %-18s %6s %10s %10s\n", "copy", "memories", "fields", "elements", "GB/s");
+  for (long long n = min_elements; n <= max_elements; n *= 16)
+    {
+      Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+      IndexSpace is = rt->create_index_space(ctx,rec);
+      IndexPartition ip = rt->create_equal_partition(ctx, is, color_is);
+      r.src = rt->create_logical_region(ctx,is,fs);
+      r.dst = rt->create_logical_region(ctx,is,fs);
+      r.idx = rt->create_logical_region(ctx,is,idx_fs);
+      r.src_lp = rt->get_logical_partition(ctx, r.src, ip);
+      r.dst_lp = rt->get_logical_partition(ctx, r.dst, ip);
+
+      TaskLauncher init_launcher(INIT_TASK_ID, TaskArgument(&max_fields,sizeof(max_fields)));
+      init_launcher.add_region_requirement(RegionRequirement(r.src, WRITE_DISCARD, EXCLUSIVE, r.src));
+      add_data_fields(init_launcher.region_requirements[0], max_fields);
+      rt->execute_task(ctx, init_launcher);
+      TaskLauncher ptr_launcher(PTR_TASK_ID, TaskArgument(&stride,sizeof(stride)));
+      ptr_launcher.add_region_requirement(RegionRequirement(r.idx, WRITE_DISCARD, EXCLUSIVE, r.idx));
+      ptr_launcher.add_field(0, FIELD_PTR);
+      rt->execute_task(ctx, ptr_launcher);
+
+      for (r.num_fields = 1; r.num_fields <= max_fields; r.num_fields *= 2)
+        {
+          for (unsigned s = 0; s < kinds.size(); s++)
+            for (unsigned d = 0; d < kinds.size(); d++)
+              {
+                char memories[64];
+                snprintf(memories, sizeof(memories), "%s -> %s",
+                         memory_name(kinds[s]), memory_name(kinds[d]));
+                const MappingTagID tag = copy_tag(kinds[s], kinds[d]);
+                printf("%-8s %-18s %6d %10lld %10.3f\n", "copy", memories, r.num_fields, n,
+                       bandwidth(ctx, rt, r, tag, false, CHECK_DIRECT, n, trials));
+                printf("%-8s %-18s %6d %10lld %10.3f\n", "index", memories, r.num_fields, n,
+                       bandwidth(ctx, rt, r, tag, true, CHECK_DIRECT, n, trials));
+              }
+          const MappingTagID tag = copy_tag(Memory::SYSTEM_MEM, Memory::SYSTEM_MEM);
+          printf("%-8s %-18s %6d %10lld %10.3f\n", "gather", "sysmem -> sysmem", r.num_fields, n,
+                 bandwidth(ctx, rt, r, tag, false, CHECK_GATHER, n, trials));
+          printf("%-8s %-18s %6d %10lld %10.3f\n", "scatter", "sysmem -> sysmem", r.num_fields, n,
+                 bandwidth(ctx, rt, r, tag, false, CHECK_SCATTER, n, trials));
+        }
+
+      rt->destroy_logical_region(ctx,r.src);
+      rt->destroy_logical_region(ctx,r.dst);
+      rt->destroy_logical_region(ctx,r.idx);
+      rt->destroy_index_partition(ctx,ip);
+      rt->destroy_index_space(ctx,is);
+    }
+
+  rt->destroy_index_space(ctx,color_is);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_field_space(ctx,idx_fs);
+}
+
+// Field FIELD_DATA + f of element i holds i + f
+void init_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const int num_fields = *((const int *) task->args);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (int f = 0; f < num_fields; f++)
+    {
+      const FieldAccessor<WRITE_DISCARD,double,1> fa(rgns[0], FIELD_DATA + f);
+      for (PointInRectIterator<1> itr(d); itr(); itr++)
+        {
+          fa[*itr] = (*itr)[0] + f;
+        }
+    }
+}
+
+// Element i points to element i * stride mod n, a permutation of the region when n is a power of 2
+void ptr_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  const long long stride = *((const long long *) task->args);
+  const FieldAccessor<WRITE_DISCARD,Point<1>,1> fa_ptr(rgns[0], FIELD_PTR);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  const long long n = d.volume();
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_ptr[*itr] = Point<1>(((*itr)[0] * stride) % n);
+    }
+}
+
+void check_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const CheckArgs &args = *((const CheckArgs *) task->args);
+  const FieldAccessor<READ_ONLY,Point<1>,1> fa_ptr(rgns[1], FIELD_PTR);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (int f = 0; f < args.num_fields; f++)
+    {
+      const FieldAccessor<READ_ONLY,double,1> fa(rgns[0], FIELD_DATA + f);
+      for (PointInRectIterator<1> itr(d); itr(); itr++)
+        {
+          switch (args.mode)
+            {
+            case CHECK_DIRECT:  assert(fa[*itr] == (*itr)[0] + f); break;
+            case CHECK_GATHER:  assert(fa[*itr] == fa_ptr[*itr][0] + f); break;
+            case CHECK_SCATTER: assert(fa[fa_ptr[*itr]] == (*itr)[0] + f); break;
+            default: assert(false);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_TASK_ID, "init_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(PTR_TASK_ID, "ptr_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<ptr_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CHECK_TASK_ID, "check_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<check_task>(registrar);
+  }
+  Runtime::add_registration_callback(CopyMapper::register_copy_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,244 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <algorithm>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INC_TASK_ID,
+};
+
+//
+// The default mapper, instrumented to measure how long map_task takes and how large
+// the instances it chooses are.  The totals are shared by the mappers of all local
+// processors and read by the top-level task between measurements, so the numbers
+// are only complete when the example runs in a single process.
+//
+class FieldStatsMapper : public DefaultMapper {
+public:
+  FieldStatsMapper(MapperRuntime *rt, Machine m, Processor p)
+    : DefaultMapper(rt, m, p, "field_stats_mapper") { }
+public:
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+public:
+  static void register_field_stats_mappers(Machine machine, Runtime *rt,
+                                           const std::set<Processor> &local_procs);
+  static void reset_stats(void);
+public:
+  static std::atomic<long long> mapped_tasks;
+  static std::atomic<long long> map_task_ns;
+  static std::atomic<long long> instance_bytes;
+};
+
+std::atomic<long long> FieldStatsMapper::mapped_tasks(0);
+std::atomic<long long> FieldStatsMapper::map_task_ns(0);
+std::atomic<long long> FieldStatsMapper::instance_bytes(0);
+
+void FieldStatsMapper::map_task(const MapperContext ctx,
+                                const Task &task,
+                                const MapTaskInput &input,
+                                MapTaskOutput &output)
+{
+  const long long start = Realm::Clock::current_time_in_nanoseconds();
+  DefaultMapper::map_task(ctx, task, input, output);
+  map_task_ns += Realm::Clock::current_time_in_nanoseconds() - start;
+  mapped_tasks++;
+  for (unsigned idx = 0; idx < output.chosen_instances.size(); idx++)
+    for (unsigned i = 0; i < output.chosen_instances[idx].size(); i++)
+      instance_bytes += output.chosen_instances[idx][i].get_instance_size();
+}
+
+/*static*/
+void FieldStatsMapper::reset_stats(void)
+{
+  mapped_tasks = 0;
+  map_task_ns = 0;
+  instance_bytes = 0;
+}
+
+/*static*/
+void FieldStatsMapper::register_field_stats_mappers(Machine machine, Runtime *rt,
+                                                    const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new FieldStatsMapper(map_rt, machine, *it), *it);
+    }
+}
+
+// Allocate num_fields doubles with IDs 0, 1, ..., num_fields-1, returning the time taken
+double allocate_one_by_one(Context ctx, Runtime *rt, FieldSpace fs, int num_fields)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  for (int f = 0; f < num_fields; f++)
+    {
+      FieldID fid = field_allocator.allocate_field(sizeof(double), f);
+      assert(fid == (FieldID)f);
+    }
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+double allocate_in_bulk(Context ctx, Runtime *rt, FieldSpace fs, int num_fields)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  std::vector<size_t> sizes(num_fields, sizeof(double));
+  std::vector<FieldID> fids(num_fields);
+  for (int f = 0; f < num_fields; f++)
+    fids[f] = f;
+  field_allocator.allocate_fields(sizes, fids);
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+// Launch tasks that each increment count fields of a fresh region, choosing fields
+// first, first + stride, first + 2*stride, ..., and report the launch rate, the mapper's
+// time per task and the size of the instances chosen per task.
+//
+void run_subset(Context ctx, Runtime *rt, IndexSpace is, FieldSpace fs, int num_fields,
+                const char *name, int count, int stride, int tasks)
+{
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+  std::vector<FieldID> fields;
+  for (int i = 0; i < count; i++)
+    fields.push_back((i * stride) % num_fields);
+
+  double zero = 0;
+  FillLauncher fill_launcher(lr, lr, TaskArgument(&zero,sizeof(zero)));
+  for (std::vector<FieldID>::const_iterator it = fields.begin(); it != fields.end(); it++)
+    fill_launcher.add_field(*it);
+  rt->fill_fields(ctx, fill_launcher);
+  rt->issue_execution_fence(ctx).get_void_result();
+
+  FieldStatsMapper::reset_stats();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  TaskLauncher inc_launcher(INC_TASK_ID, TaskArgument(NULL,0));
+  inc_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, EXCLUSIVE, lr));
+  inc_launcher.region_requirements[0].add_fields(fields);
+  for (int t = 0; t < tasks; t++)
+    rt->execute_task(ctx, inc_launcher);
+  rt->issue_execution_fence(ctx).get_void_result();
+  const double stop = Realm::Clock::current_time_in_microseconds();
+
+  const long long mapped = FieldStatsMapper::mapped_tasks;
+  assert(mapped > 0);
+  printf("  %-12s %6d fields: %10.3f us/task  map_task %10.3f us  instances %10.1f KB/task\n",
+         name, (int)fields.size(), (stop - start) / tasks,
+         FieldStatsMapper::map_task_ns * 1e-3 / mapped,
+         FieldStatsMapper::instance_bytes / 1024.0 / mapped);
+  rt->destroy_logical_region(ctx,lr);
+}
+
+//
+// Field spaces with hundreds of fields.  For each field count, compares allocating
+// the fields one at a time with allocate_field and all at once with allocate_fields,
+// then launches tasks that use one field, a contiguous block of fields, a strided
+// set of fields, and every field.
+//
+//  Command line options:
+//    -fields N   largest number of fields, at most LEGION_MAX_FIELDS
+//    -step N     the field counts used are N, 2N, 3N, ... and finally the largest
+//    -n N        number of elements in each region
+//    -tasks N    number of tasks launched per field subset
+//    -subset N   number of fields in the block and strided subsets
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int max_fields = 500;
+  int step = 128;
+  int elements = 1024;
+  int tasks = 20;
+  int subset = 8;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-fields") && (i+1) < command_args.argc)
+        max_fields = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-step") && (i+1) < command_args.argc)
+        step = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        elements = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-tasks") && (i+1) < command_args.argc)
+        tasks = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-subset") && (i+1) < command_args.argc)
+        subset = atoi(command_args.argv[++i]);
+    }
+
+  assert((step > 0) && (max_fields > 0) && (max_fields <= LEGION_MAX_FIELDS));
+
+  Rect<1> rec(Point<1>(0),Point<1>(elements - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+
+  for (int k = 1; (k - 1) * step < max_fields; k++)
+    {
+      const int num_fields = std::min(k * step, max_fields);
+      FieldSpace single_fs = rt->create_field_space(ctx);
+      const double single_us = allocate_one_by_one(ctx, rt, single_fs, num_fields);
+      FieldSpace bulk_fs = rt->create_field_space(ctx);
+      const double bulk_us = allocate_in_bulk(ctx, rt, bulk_fs, num_fields);
+      printf("%d fields: allocate_field %10.3f us  allocate_fields %10.3f us\n",
+             num_fields, single_us, bulk_us);
+
+      const int count = std::min(subset, num_fields);
+      run_subset(ctx, rt, is, bulk_fs, num_fields, "one", 1, 1, tasks);
+      run_subset(ctx, rt, is, bulk_fs, num_fields, "block", count, 1, tasks);
+      run_subset(ctx, rt, is, bulk_fs, num_fields, "strided", count, num_fields / count, tasks);
+      run_subset(ctx, rt, is, bulk_fs, num_fields, "all", num_fields, 1, tasks);
+
+      rt->destroy_field_space(ctx,single_fs);
+      rt->destroy_field_space(ctx,bulk_fs);
+    }
+
+  rt->destroy_index_space(ctx,is);
+}
+
+void inc_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (std::set<FieldID>::const_iterator it = task->regions[0].privilege_fields.begin();
+       it != task->regions[0].privilege_fields.end(); it++)
+    {
+      const FieldAccessor<READ_WRITE,double,1> fa(rgns[0], *it);
+      for (PointInRectIterator<1> itr(d); itr(); itr++)
+        {
+          fa[*itr] = fa[*itr] + 1;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INC_TASK_ID, "inc_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<inc_task>(registrar);
+  }
+  Runtime::add_registration_callback(FieldStatsMapper::register_field_stats_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,378 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  INIT_SPARSE_TASK_ID,
+  INIT_DENSE_TASK_ID,
+  SUM_SPARSE_POINTS_TASK_ID,
+  SUM_SPARSE_RECTS_TASK_ID,
+  SUM_DENSE_MASKED_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_VALUE,
+  FIELD_MASK,
+};
+
+//
+// The occupied cells of the grid, chosen the way adaptive mesh refinement data often
+// looks: whole blocks of block^3 cells, aligned to the block size, picked at random
+// until the requested fraction of the grid is occupied.  The same parameters always
+// give the same cells.
+//
+struct GridParams {
+  int grid;
+  int block;
+  double occupancy;
+};
+
+std::vector<bool> select_blocks(const GridParams &params)
+{
+  const int blocks_per_side = params.grid / params.block;
+  const int num_blocks = blocks_per_side * blocks_per_side * blocks_per_side;
+  std::vector<int> order(num_blocks);
+  for (int b = 0; b < num_blocks; b++)
+    order[b] = b;
+  std::mt19937 rng(12345);
+  std::shuffle(order.begin(), order.end(), rng);
+  const int chosen = std::max(1, (int)(params.occupancy * num_blocks));
+  std::vector<bool> occupied(num_blocks, false);
+  for (int b = 0; b < chosen; b++)
+    occupied[order[b]] = true;
+  return occupied;
+}
+
+bool cell_occupied(const GridParams &params, const std::vector<bool> &occupied, const Point<3> &p)
+{
+  const int blocks_per_side = params.grid / params.block;
+  const int bx = p[0] / params.block, by = p[1] / params.block, bz = p[2] / params.block;
+  return occupied[(bz * blocks_per_side + by) * blocks_per_side + bx];
+}
+
+double cell_value(const Point<3> &p)
+{
+  return p[0] + p[1] + p[2];
+}
+
+//
+// The default mapper lays out an instance of a sparse region over the bounding box of
+// the region, which costs as much memory as a dense region.  This mapper asks for a
+// compact layout instead, with storage only for the rectangles that make up the
+// sparse index space, and records the size of the instances chosen for each kind of
+// region so the top-level task can report the memory footprint.
+//
+class SparseMapper : public DefaultMapper {
+public:
+  SparseMapper(MapperRuntime *rt, Machine m, Processor p)
+    : DefaultMapper(rt, m, p, "sparse_mapper") { }
+public:
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+protected:
+  virtual void default_policy_select_constraints(MapperContext ctx,
+                                                 LayoutConstraintSet &constraints,
+                                                 Memory target_memory,
+                                                 const RegionRequirement &req);
+public:
+  static void register_sparse_mappers(Machine machine, Runtime *rt,
+                                      const std::set<Processor> &local_procs);
+public:
+  static std::atomic<size_t> dense_instance_bytes;
+  static std::atomic<size_t> sparse_instance_bytes;
+};
+
+std::atomic<size_t> SparseMapper::dense_instance_bytes(0);
+std::atomic<size_t> SparseMapper::sparse_instance_bytes(0);
+
+void SparseMapper::default_policy_select_constraints(MapperContext ctx,
+                                                     LayoutConstraintSet &constraints,
+                                                     Memory target_memory,
+                                                     const RegionRequirement &req)
+{
+  DefaultMapper::default_policy_select_constraints(ctx, constraints, target_memory, req);
+  if (!runtime->get_index_space_domain(ctx, req.region.get_index_space()).dense())
+    constraints.add_constraint(SpecializedConstraint(LEGION_COMPACT_SPECIALIZE));
+}
+
+void SparseMapper::map_task(const MapperContext ctx,
+                            const Task &task,
+                            const MapTaskInput &input,
+                            MapTaskOutput &output)
+{
+  DefaultMapper::map_task(ctx, task, input, output);
+  for (unsigned idx = 0; idx < output.chosen_instances.size(); idx++)
+    {
+      size_t bytes = 0;
+      for (unsigned i = 0; i < output.chosen_instances[idx].size(); i++)
+        bytes += output.chosen_instances[idx][i].get_instance_size();
+      if (runtime->get_index_space_domain(ctx, task.regions[idx].region.get_index_space()).dense())
+        dense_instance_bytes = bytes;
+      else
+        sparse_instance_bytes = bytes;
+    }
+}
+
+/*static*/
+void SparseMapper::register_sparse_mappers(Machine machine, Runtime *rt,
+                                           const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new SparseMapper(map_rt, machine, *it), *it);
+    }
+}
+
+double run_sum(Context ctx, Runtime *rt, TaskID tid, LogicalRegion lr, bool with_mask,
+               int trials, double &sum)
+{
+  TaskLauncher sum_launcher(tid, TaskArgument(NULL,0));
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0, FIELD_VALUE);
+  if (with_mask)
+    sum_launcher.add_field(0, FIELD_MASK);
+  // The first launch creates the instance; time only the ones after it
+  sum = rt->execute_task(ctx, sum_launcher).get_result<double>();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  for (int t = 0; t < trials; t++)
+    {
+      double result = rt->execute_task(ctx, sum_launcher).get_result<double>();
+      assert(result == sum);
+    }
+  return (Realm::Clock::current_time_in_microseconds() - start) / trials;
+}
+
+//
+// Builds a sparse 3D index space from a list of points and compares it with a dense
+// region over the whole grid that marks the occupied cells with a mask field.  The
+// sparse region is summed both point by point with a PointInDomainIterator and one
+// rectangle at a time with a RectInDomainIterator; the dense region is summed by
+// visiting every cell and skipping those not in the mask.
+//
+//  Command line options:
+//    -grid N        cells along each side of the grid
+//    -block N       side of the blocks of occupied cells (must divide the grid)
+//    -occupancy F   fraction of the grid that is occupied
+//    -trials N      number of timed launches of each sum task
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  GridParams params;
+  params.grid = 64;
+  params.block = 4;
+  params.occupancy = 0.01;
+  int trials = 5;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-grid") && (i+1) < command_args.argc)
+        params.grid = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-block") && (i+1) < command_args.argc)
+        params.block = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-occupancy") && (i+1) < command_args.argc)
+        params.occupancy = atof(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-trials") && (i+1) < command_args.argc)
+        trials = atoi(command_args.argv[++i]);
+    }
+  assert((params.grid % params.block) == 0);
+
+  const Rect<3> bounds(Point<3>(0,0,0), Point<3>(params.grid - 1, params.grid - 1, params.grid - 1));
+  const std::vector<bool> occupied = select_blocks(params);
+  std::vector<Point<3> > points;
+  for (PointInRectIterator<3> itr(bounds); itr(); itr++)
+    if (cell_occupied(params, occupied, *itr))
+      points.push_back(*itr);
+  printf("%zu of %zu cells occupied (%.2f%%)\n", points.size(), bounds.volume(),
+         100.0 * points.size() / bounds.volume());
+
+  IndexSpace sparse_is = rt->create_index_space(ctx, points);
+  IndexSpace dense_is = rt->create_index_space(ctx, bounds);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fidv = field_allocator.allocate_field(sizeof(double), FIELD_VALUE);
+  assert(fidv == FIELD_VALUE);
+  FieldID fidm = field_allocator.allocate_field(sizeof(bool), FIELD_MASK);
+  assert(fidm == FIELD_MASK);
+  LogicalRegion sparse_lr = rt->create_logical_region(ctx,sparse_is,fs);
+  LogicalRegion dense_lr = rt->create_logical_region(ctx,dense_is,fs);
+
+  TaskLauncher sparse_launcher(INIT_SPARSE_TASK_ID, TaskArgument(NULL,0));
+  sparse_launcher.add_region_requirement(RegionRequirement(sparse_lr, WRITE_DISCARD, EXCLUSIVE, sparse_lr));
+  sparse_launcher.add_field(0, FIELD_VALUE);
+  rt->execute_task(ctx, sparse_launcher);
+  TaskLauncher dense_launcher(INIT_DENSE_TASK_ID, TaskArgument(&params,sizeof(params)));
+  dense_launcher.add_region_requirement(RegionRequirement(dense_lr, WRITE_DISCARD, EXCLUSIVE, dense_lr));
+  dense_launcher.add_field(0, FIELD_VALUE);
+  dense_launcher.add_field(0, FIELD_MASK);
+  rt->execute_task(ctx, dense_launcher);
+
+  double points_sum, rects_sum, masked_sum;
+  const double points_us = run_sum(ctx, rt, SUM_SPARSE_POINTS_TASK_ID, sparse_lr, false,
+                                    trials, points_sum);
+  const double rects_us = run_sum(ctx, rt, SUM_SPARSE_RECTS_TASK_ID, sparse_lr, false,
+                                   trials, rects_sum);
+  const double masked_us = run_sum(ctx, rt, SUM_DENSE_MASKED_TASK_ID, dense_lr, true,
+                                    trials, masked_sum);
+  assert(points_sum == rects_sum);
+  assert(points_sum == masked_sum);
+
+  printf("sparse, by point:      %10.3f us per sum\n", points_us);
+  printf("sparse, by rectangle:  %10.3f us per sum\n", rects_us);
+  printf("dense with mask:       %10.3f us per sum\n", masked_us);
+  printf("instance memory: sparse %10.1f KB  dense %10.1f KB\n",
+         SparseMapper::sparse_instance_bytes / 1024.0,
+         SparseMapper::dense_instance_bytes / 1024.0);
+
+  rt->destroy_logical_region(ctx,sparse_lr);
+  rt->destroy_logical_region(ctx,dense_lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,sparse_is);
+  rt->destroy_index_space(ctx,dense_is);
+}
+
+// Instances of the sparse region are compact, so they are accessed with a
+// MultiAffineAccessor, which finds the piece of the instance holding each point.
+void init_sparse_task(const Task *task,
+		      const std::vector<PhysicalRegion> &rgns,
+		      Context ctx, Runtime *rt)
+{
+  const MultiAffineAccessor<double,3> fa_v(rgns[0], FIELD_VALUE);
+  Domain d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (RectInDomainIterator<3> rect(d); rect(); rect++)
+    for (PointInRectIterator<3> itr(*rect); itr(); itr++)
+      {
+        fa_v[*itr] = cell_value(*itr);
+      }
+}
+
+void init_dense_task(const Task *task,
+		     const std::vector<PhysicalRegion> &rgns,
+		     Context ctx, Runtime *rt)
+{
+  const GridParams &params = *((const GridParams *) task->args);
+  const std::vector<bool> occupied = select_blocks(params);
+  const FieldAccessor<WRITE_DISCARD,double,3> fa_v(rgns[0], FIELD_VALUE);
+  const FieldAccessor<WRITE_DISCARD,bool,3> fa_m(rgns[0], FIELD_MASK);
+  Rect<3> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<3> itr(d); itr(); itr++)
+    {
+      const bool in = cell_occupied(params, occupied, *itr);
+      fa_m[*itr] = in;
+      fa_v[*itr] = in ? cell_value(*itr) : 0;
+    }
+}
+
+// Visit every point of the sparse index space, looking each one up in the instance
+double sum_sparse_points_task(const Task *task,
+			      const std::vector<PhysicalRegion> &rgns,
+			      Context ctx, Runtime *rt)
+{
+  const MultiAffineAccessor<double,3> fa_v(rgns[0], FIELD_VALUE);
+  Domain d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (PointInDomainIterator<3> itr(d); itr(); itr++)
+    {
+      sum += fa_v[*itr];
+    }
+  return sum;
+}
+
+//
+// Visit the sparse index space one dense rectangle at a time.  The instance is looked
+// up once per row of a rectangle, and the row is then contiguous in memory because
+// the first dimension is laid out fastest.
+//
+double sum_sparse_rects_task(const Task *task,
+			     const std::vector<PhysicalRegion> &rgns,
+			     Context ctx, Runtime *rt)
+{
+  const MultiAffineAccessor<double,3> fa_v(rgns[0], FIELD_VALUE);
+  Domain d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (RectInDomainIterator<3> rect(d); rect(); rect++)
+    for (coord_t z = rect->lo[2]; z <= rect->hi[2]; z++)
+      for (coord_t y = rect->lo[1]; y <= rect->hi[1]; y++)
+        {
+          const double *row = fa_v.ptr(Point<3>(rect->lo[0], y, z));
+          const coord_t length = rect->hi[0] - rect->lo[0] + 1;
+          for (coord_t x = 0; x < length; x++)
+            sum += row[x];
+        }
+  return sum;
+}
+
+double sum_dense_masked_task(const Task *task,
+			     const std::vector<PhysicalRegion> &rgns,
+			     Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,double,3> fa_v(rgns[0], FIELD_VALUE);
+  const FieldAccessor<READ_ONLY,bool,3> fa_m(rgns[0], FIELD_MASK);
+  Rect<3> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double sum = 0;
+  for (PointInRectIterator<3> itr(d); itr(); itr++)
+    {
+      if (fa_m[*itr])
+        sum += fa_v[*itr];
+    }
+  return sum;
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_SPARSE_TASK_ID, "init_sparse_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_sparse_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INIT_DENSE_TASK_ID, "init_dense_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<init_dense_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_SPARSE_POINTS_TASK_ID, "sum_sparse_points_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_sparse_points_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_SPARSE_RECTS_TASK_ID, "sum_sparse_rects_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_sparse_rects_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_DENSE_MASKED_TASK_ID, "sum_dense_masked_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,sum_dense_masked_task>(registrar);
+  }
+  Runtime::add_registration_callback(SparseMapper::register_sparse_mappers);
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,317 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+//
+// The driver and increment tasks are each registered twice, under different task IDs:
+// once as plain tasks and once annotated as inner and leaf tasks respectively.
+//
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  DRIVER_TASK_ID,
+  DRIVER_INNER_TASK_ID,
+  INC_TASK_ID,
+  INC_LEAF_TASK_ID,
+  SUM_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_A,
+};
+
+enum Patterns {
+  PATTERN_PARTITION,
+  PATTERN_ATOMIC,
+};
+
+struct DriverArgs {
+  int pattern;
+  TaskID inc_task_id;
+  LogicalPartition lp;
+  Rect<1> colors;
+  int steps;
+  int tasks;
+};
+
+//
+// Records the time the default mapper spends in map_task and the size of the
+// instances it chooses; the default mapper gives inner tasks virtual mappings.
+//
+class AnnotationMapper : public DefaultMapper {
+public:
+  AnnotationMapper(MapperRuntime *rt, Machine m, Processor p)
+    : DefaultMapper(rt, m, p, "annotation_mapper") { }
+public:
+  virtual void map_task(const MapperContext ctx,
+                        const Task &task,
+                        const MapTaskInput &input,
+                        MapTaskOutput &output);
+public:
+  static void register_annotation_mappers(Machine machine, Runtime *rt,
+                                          const std::set<Processor> &local_procs);
+  static void reset_stats(void);
+public:
+  static std::atomic<long long> mapped_tasks;
+  static std::atomic<long long> map_task_ns;
+  static std::atomic<long long> instance_bytes;
+};
+
+std::atomic<long long> AnnotationMapper::mapped_tasks(0);
+std::atomic<long long> AnnotationMapper::map_task_ns(0);
+std::atomic<long long> AnnotationMapper::instance_bytes(0);
+
+void AnnotationMapper::map_task(const MapperContext ctx,
+                                const Task &task,
+                                const MapTaskInput &input,
+                                MapTaskOutput &output)
+{
+  const long long start = Realm::Clock::current_time_in_nanoseconds();
+  DefaultMapper::map_task(ctx, task, input, output);
+  map_task_ns += Realm::Clock::current_time_in_nanoseconds() - start;
+  mapped_tasks++;
+  for (unsigned idx = 0; idx < output.chosen_instances.size(); idx++)
+    for (unsigned i = 0; i < output.chosen_instances[idx].size(); i++)
+      if (!output.chosen_instances[idx][i].is_virtual_instance())
+        instance_bytes += output.chosen_instances[idx][i].get_instance_size();
+}
+
+/*static*/
+void AnnotationMapper::reset_stats(void)
+{
+  mapped_tasks = 0;
+  map_task_ns = 0;
+  instance_bytes = 0;
+}
+
+/*static*/
+void AnnotationMapper::register_annotation_mappers(Machine machine, Runtime *rt,
+                                                   const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new AnnotationMapper(map_rt, machine, *it), *it);
+    }
+}
+
+long long sum_region(Context ctx, Runtime *rt, LogicalRegion lr)
+{
+  TaskLauncher sum_launcher(SUM_TASK_ID, TaskArgument(NULL,0));
+  sum_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  sum_launcher.add_field(0, FIELD_A);
+  return rt->execute_task(ctx, sum_launcher).get_result<long long>();
+}
+
+//
+// Run one driver task and report its time and the mapper's work.  Returns the number
+// of times every element of the region was incremented.
+//
+long long run_driver(Context ctx, Runtime *rt, LogicalRegion lr, const DriverArgs &args,
+                     bool inner, bool leaf)
+{
+  DriverArgs driver_args = args;
+  driver_args.inc_task_id = leaf ? INC_LEAF_TASK_ID : INC_TASK_ID;
+  TaskLauncher driver_launcher(inner ? DRIVER_INNER_TASK_ID : DRIVER_TASK_ID,
+                               TaskArgument(&driver_args, sizeof(driver_args)));
+  driver_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, EXCLUSIVE, lr));
+  driver_launcher.add_field(0, FIELD_A);
+
+  rt->issue_execution_fence(ctx).get_void_result();
+  AnnotationMapper::reset_stats();
+  const double start = Realm::Clock::current_time_in_microseconds();
+  rt->execute_task(ctx, driver_launcher).get_void_result();
+  const double us = Realm::Clock::current_time_in_microseconds() - start;
+
+  const long long subtasks = (args.pattern == PATTERN_PARTITION) ?
+    (long long)args.steps * args.colors.volume() : (long long)args.steps * args.tasks;
+  printf("  %-5s driver, %-5s subtasks: %10.3f ms  %8.3f us per subtask  "
+         "map_task %8.3f us per task  %10.3f MB of instances\n",
+         inner ? "inner" : "plain", leaf ? "leaf" : "plain", us * 1e-3, us / subtasks,
+         AnnotationMapper::map_task_ns * 1e-3 / AnnotationMapper::mapped_tasks,
+         AnnotationMapper::instance_bytes / 1048576.0);
+  return (args.pattern == PATTERN_PARTITION) ? args.steps : (long long)args.steps * args.tasks;
+}
+
+//
+// Runs the patterns of Coherence/atomic/atomic.cc (many single tasks updating one region
+// with atomic coherence) and Partitions/equal/equal.cc (index launches over an equal
+// partition) at scale, from a driver task that owns the region, with every combination
+// of inner and leaf annotations.
+//
+//  Command line options:
+//    -n N        elements in the region
+//    -colors N   subregions of the partition
+//    -steps N    index launches (partition) or rounds of single launches (atomic)
+//    -tasks N    single launches per round in the atomic pattern
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  long long n = 1 << 20;
+  int num_colors = 64;
+  int steps = 20;
+  int tasks = 50;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-colors") && (i+1) < command_args.argc)
+        num_colors = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-steps") && (i+1) < command_args.argc)
+        steps = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-tasks") && (i+1) < command_args.argc)
+        tasks = atoi(command_args.argv[++i]);
+    }
+
+  Rect<1> rec(Point<1>(0),Point<1>(n - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fida = field_allocator.allocate_field(sizeof(int), FIELD_A);
+  assert(fida == FIELD_A);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+  Rect<1> colors(0,num_colors - 1);
+  IndexSpace color_is = rt->create_index_space(ctx, colors);
+  IndexPartition ip = rt->create_equal_partition(ctx, is, color_is);
+  LogicalPartition lp = rt->get_logical_partition(ctx, lr, ip);
+
+  int init = 0;
+  rt->fill_field(ctx,lr,lr,fida,&init,sizeof(init));
+  long long increments = 0;
+
+  DriverArgs args;
+  args.lp = lp;
+  args.colors = colors;
+  args.steps = steps;
+  args.tasks = tasks;
+  const int patterns[] = { PATTERN_PARTITION, PATTERN_ATOMIC };
+  for (unsigned p = 0; p < 2; p++)
+    {
+      args.pattern = patterns[p];
+      if (args.pattern == PATTERN_PARTITION)
+        printf("%d index launches over %d subregions of %lld elements:\n", steps, num_colors, n);
+      else
+        printf("%d single launches with atomic coherence on %lld elements:\n", steps * tasks, n);
+      for (int inner = 0; inner < 2; inner++)
+        for (int leaf = 0; leaf < 2; leaf++)
+          {
+            increments += run_driver(ctx, rt, lr, args, inner, leaf);
+            assert(sum_region(ctx, rt, lr) == increments * n);
+          }
+    }
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,color_is);
+  rt->destroy_index_space(ctx,is);
+}
+
+//
+// Launches all the increment tasks on the region it was given.  The driver never touches
+// the region itself, so it can be registered as an inner task.
+//
+void driver_task(const Task *task,
+		 const std::vector<PhysicalRegion> &rgns,
+		 Context ctx, Runtime *rt)
+{
+  const DriverArgs args = *((const DriverArgs *) task->args);
+  const LogicalRegion lr = task->regions[0].region;
+  for (int s = 0; s < args.steps; s++)
+    {
+      if (args.pattern == PATTERN_PARTITION)
+        {
+          ArgumentMap arg_map;
+          IndexLauncher inc_launcher(args.inc_task_id, args.colors, TaskArgument(NULL,0), arg_map);
+          inc_launcher.add_region_requirement(RegionRequirement(args.lp, 0, READ_WRITE, EXCLUSIVE, lr));
+          inc_launcher.region_requirements[0].add_field(FIELD_A);
+          rt->execute_index_space(ctx, inc_launcher);
+        }
+      else
+        {
+          for (int t = 0; t < args.tasks; t++)
+            {
+              TaskLauncher inc_launcher(args.inc_task_id, TaskArgument(NULL,0));
+              inc_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, ATOMIC, lr));
+              inc_launcher.add_field(0, FIELD_A);
+              rt->execute_task(ctx, inc_launcher);
+            }
+        }
+    }
+}
+
+void inc_task(const Task *task,
+	      const std::vector<PhysicalRegion> &rgns,
+	      Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_WRITE,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_a[*itr] = fa_a[*itr] + 1;
+    }
+}
+
+long long sum_task(const Task *task,
+		   const std::vector<PhysicalRegion> &rgns,
+		   Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,int,1> fa_a(rgns[0], FIELD_A);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  long long sum = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      sum += fa_a[*itr];
+    }
+  return sum;
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(DRIVER_TASK_ID, "driver_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<driver_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(DRIVER_INNER_TASK_ID, "driver_task (inner)");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<driver_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INC_TASK_ID, "inc_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<inc_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(INC_LEAF_TASK_ID, "inc_task (leaf)");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<inc_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SUM_TASK_ID, "sum_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<long long,sum_task>(registrar);
+  }
+  Runtime::add_registration_callback(AnnotationMapper::register_annotation_mappers);
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,231 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  STEP_TASK_ID,
+  RESIDUAL_TASK_ID,
+  CHECK_TASK_ID,
+};
+
+enum FieldIDs {
+  FIELD_X,
+};
+
+//
+// A stand-in for one iteration of a solver: every step halves the solution, and the
+// residual is the largest remaining value, so the loop converges after a known number
+// of steps.
+//
+void launch_step(Context ctx, Runtime *rt, LogicalRegion lr, const Predicate &pred)
+{
+  TaskLauncher step_launcher(STEP_TASK_ID, TaskArgument(NULL,0), pred);
+  step_launcher.add_region_requirement(RegionRequirement(lr, READ_WRITE, EXCLUSIVE, lr));
+  step_launcher.add_field(0, FIELD_X);
+  rt->execute_task(ctx, step_launcher);
+}
+
+// If the launch is predicated away its result is the previous residual instead
+Future launch_residual(Context ctx, Runtime *rt, LogicalRegion lr, const Predicate &pred,
+                       const Future &previous)
+{
+  TaskLauncher residual_launcher(RESIDUAL_TASK_ID, TaskArgument(NULL,0), pred);
+  residual_launcher.add_region_requirement(RegionRequirement(lr, READ_ONLY, EXCLUSIVE, lr));
+  residual_launcher.add_field(0, FIELD_X);
+  residual_launcher.predicate_false_future = previous;
+  return rt->execute_task(ctx, residual_launcher);
+}
+
+void reset(Context ctx, Runtime *rt, LogicalRegion lr)
+{
+  double one = 1;
+  rt->fill_field(ctx,lr,lr,FIELD_X,&one,sizeof(one));
+  rt->issue_execution_fence(ctx).get_void_result();
+}
+
+//
+// The usual loop: wait for the residual of every iteration before launching the
+// next one.  Nothing is in flight while the top-level task waits.
+//
+double run_blocking(Context ctx, Runtime *rt, LogicalRegion lr, double tolerance,
+                    int max_iterations, int &iterations)
+{
+  reset(ctx, rt, lr);
+  const double start = Realm::Clock::current_time_in_microseconds();
+  iterations = 0;
+  while (iterations < max_iterations)
+    {
+      launch_step(ctx, rt, lr, Predicate::TRUE_PRED);
+      iterations++;
+      Future residual = launch_residual(ctx, rt, lr, Predicate::TRUE_PRED, Future());
+      if (residual.get_result<double>() <= tolerance)
+        break;
+    }
+  rt->issue_execution_fence(ctx).get_void_result();
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+// The predicated loop: a check task turns each residual into a boolean future that
+// is true while the loop has not converged, and the launches of the next iteration
+// are predicated on it.  The top-level task runs ahead, launching run_ahead
+// iterations before it waits on a single check result; iterations launched after
+// convergence are predicated false and skipped by the runtime.  Because a skipped
+// check task returns false, once the predicate becomes false it stays false.
+//
+double run_predicated(Context ctx, Runtime *rt, LogicalRegion lr, double tolerance,
+                      int max_iterations, int run_ahead, int &issued)
+{
+  reset(ctx, rt, lr);
+  const double start = Realm::Clock::current_time_in_microseconds();
+  const bool predicate_false = false;
+  Future residual = launch_residual(ctx, rt, lr, Predicate::TRUE_PRED, Future());
+  Future not_converged;
+  Predicate pred = Predicate::TRUE_PRED;
+  issued = 0;
+  while (issued < max_iterations)
+    {
+      for (int i = 0; (i < run_ahead) && (issued < max_iterations); i++)
+        {
+          launch_step(ctx, rt, lr, pred);
+          issued++;
+          residual = launch_residual(ctx, rt, lr, pred, residual);
+          TaskLauncher check_launcher(CHECK_TASK_ID, TaskArgument(&tolerance,sizeof(tolerance)), pred);
+          check_launcher.add_future(residual);
+          check_launcher.predicate_false_result = TaskArgument(&predicate_false,sizeof(predicate_false));
+          not_converged = rt->execute_task(ctx, check_launcher);
+          pred = rt->create_predicate(ctx, not_converged);
+        }
+      if (!not_converged.get_result<bool>())
+        break;
+    }
+  rt->issue_execution_fence(ctx).get_void_result();
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+//
+//  Command line options:
+//    -n N          number of elements in the solution
+//    -tol T        convergence tolerance on the residual
+//    -runahead K   iterations launched by the predicated loop between waits
+//    -max N        maximum number of iterations
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &rgns,
+		    Context ctx,
+		    Runtime *rt)
+{
+  int elements = 1 << 16;
+  double tolerance = 1e-12;
+  int run_ahead = 4;
+  int max_iterations = 1000;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        elements = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-tol") && (i+1) < command_args.argc)
+        tolerance = atof(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-runahead") && (i+1) < command_args.argc)
+        run_ahead = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_iterations = atoi(command_args.argv[++i]);
+    }
+  assert(run_ahead > 0);
+
+  Rect<1> rec(Point<1>(0),Point<1>(elements - 1));
+  IndexSpace is = rt->create_index_space(ctx,rec);
+  FieldSpace fs = rt->create_field_space(ctx);
+  FieldAllocator field_allocator = rt->create_field_allocator(ctx,fs);
+  FieldID fidx = field_allocator.allocate_field(sizeof(double), FIELD_X);
+  assert(fidx == FIELD_X);
+  LogicalRegion lr = rt->create_logical_region(ctx,is,fs);
+
+  int iterations, issued;
+  const double blocking_us = run_blocking(ctx, rt, lr, tolerance, max_iterations, iterations);
+  const double blocking_residual =
+    launch_residual(ctx, rt, lr, Predicate::TRUE_PRED, Future()).get_result<double>();
+  const double predicated_us = run_predicated(ctx, rt, lr, tolerance, max_iterations,
+                                              run_ahead, issued);
+  const double predicated_residual =
+    launch_residual(ctx, rt, lr, Predicate::TRUE_PRED, Future()).get_result<double>();
+  // Both loops must stop after the same step, however far the predicated loop ran ahead
+  assert(blocking_residual == predicated_residual);
+
+  printf("blocking:   %10.3f ms, %d iterations\n", blocking_us * 1e-3, iterations);
+  printf("predicated: %10.3f ms, %d iterations launched (run ahead %d)\n",
+         predicated_us * 1e-3, issued, run_ahead);
+
+  rt->destroy_logical_region(ctx,lr);
+  rt->destroy_field_space(ctx,fs);
+  rt->destroy_index_space(ctx,is);
+}
+
+void step_task(const Task *task,
+	       const std::vector<PhysicalRegion> &rgns,
+	       Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_WRITE,double,1> fa_x(rgns[0], FIELD_X);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      fa_x[*itr] = 0.5 * fa_x[*itr];
+    }
+}
+
+double residual_task(const Task *task,
+		     const std::vector<PhysicalRegion> &rgns,
+		     Context ctx, Runtime *rt)
+{
+  const FieldAccessor<READ_ONLY,double,1> fa_x(rgns[0], FIELD_X);
+  Rect<1> d = rt->get_index_space_domain(ctx,task->regions[0].region.get_index_space());
+  double residual = 0;
+  for (PointInRectIterator<1> itr(d); itr(); itr++)
+    {
+      residual = fmax(residual, fabs(fa_x[*itr]));
+    }
+  return residual;
+}
+
+bool check_task(const Task *task,
+		const std::vector<PhysicalRegion> &rgns,
+		Context ctx, Runtime *rt)
+{
+  const double tolerance = *((const double *) task->args);
+  return task->futures[0].get_result<double>() > tolerance;
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(STEP_TASK_ID, "step_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<step_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(RESIDUAL_TASK_ID, "residual_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,residual_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(CHECK_TASK_ID, "check_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<bool,check_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,78 @@
+#ifndef __DIM_DISPATCH_H__
+#define __DIM_DISPATCH_H__
+
+#include <utility>
+#include "legion.h"
+
+//
+// Helpers for writing code once for every dimension while keeping the dimension a
+// compile-time constant in inner loops.  A Domain is converted to a Rect<DIM> once, by
+// dispatch_dim, and from then on everything is statically typed:
+//
+//   struct Volume {
+//     template<int DIM>
+//     static size_t apply(const Legion::Rect<DIM> &rect) { return rect.volume(); }
+//   };
+//   size_t v = dispatch_dim<Volume>(domain);
+//
+
+#ifndef DIM_DISPATCH_MAX_DIM
+#define DIM_DISPATCH_MAX_DIM 3
+#endif
+
+//
+// Call FUNCTOR::apply<DIM>(rect, args...) with the bounds of a dense domain as a
+// Rect<DIM>, where DIM is the dimension of the domain (1 to DIM_DISPATCH_MAX_DIM).
+//
+template<typename FUNCTOR, typename... ARGS>
+inline auto dispatch_dim(const Legion::Domain &domain, ARGS&&... args)
+  -> decltype(FUNCTOR::template apply<1>(Legion::Rect<1>(), std::forward<ARGS>(args)...))
+{
+  assert(domain.dense());
+  switch (domain.get_dim())
+    {
+    case 1: return FUNCTOR::template apply<1>(Legion::Rect<1>(domain), std::forward<ARGS>(args)...);
+#if DIM_DISPATCH_MAX_DIM >= 2
+    case 2: return FUNCTOR::template apply<2>(Legion::Rect<2>(domain), std::forward<ARGS>(args)...);
+#endif
+#if DIM_DISPATCH_MAX_DIM >= 3
+    case 3: return FUNCTOR::template apply<3>(Legion::Rect<3>(domain), std::forward<ARGS>(args)...);
+#endif
+    default: assert(false);
+    }
+  return FUNCTOR::template apply<1>(Legion::Rect<1>(), std::forward<ARGS>(args)...);
+}
+
+//
+// One nested for loop per dimension, generated at compile time.  Dimension 0 is the
+// innermost loop, matching the default layout of instances, in which dimension 0 varies
+// fastest.
+//
+template<int DIM, int D = DIM - 1>
+struct RectLoop {
+  template<typename F>
+  static inline void run(const Legion::Rect<DIM> &rect, Legion::Point<DIM> &p, F &f)
+  {
+    for (p[D] = rect.lo[D]; p[D] <= rect.hi[D]; p[D]++)
+      RectLoop<DIM,D-1>::run(rect, p, f);
+  }
+};
+
+template<int DIM>
+struct RectLoop<DIM,-1> {
+  template<typename F>
+  static inline void run(const Legion::Rect<DIM> &rect, Legion::Point<DIM> &p, F &f)
+  {
+    f(p);
+  }
+};
+
+// Call f(p) for every point p of rect
+template<int DIM, typename F>
+inline void for_each_point(const Legion::Rect<DIM> &rect, F f)
+{
+  Legion::Point<DIM> p;
+  RectLoop<DIM>::run(rect, p, f);
+}
+
+#endif
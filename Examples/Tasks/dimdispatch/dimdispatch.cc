@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include "legion.h"
+#include "dim_dispatch.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+};
+
+//
+// The kernel: a weighted sum of the coordinates of every point of a domain.  It is
+// written three ways, from fully dynamic to fully static.
+//
+
+// A Domain visited with a DomainPointIterator, checking the dimension of every point
+long long sum_domain_points(const Domain &domain)
+{
+  long long sum = 0;
+  for (Domain::DomainPointIterator itr(domain); itr; itr++)
+    for (int i = 0; i < itr.p.get_dim(); i++)
+      sum += (i + 1) * itr.p[i];
+  return sum;
+}
+
+// Dispatched once on the dimension, then visited with a PointInRectIterator
+struct SumRectIterator {
+  template<int DIM>
+  static long long apply(const Rect<DIM> &rect)
+  {
+    long long sum = 0;
+    for (PointInRectIterator<DIM> itr(rect); itr(); itr++)
+      for (int i = 0; i < DIM; i++)
+        sum += (i + 1) * (*itr)[i];
+    return sum;
+  }
+};
+
+// Dispatched once on the dimension, then visited with nested loops unrolled at compile time
+struct SumRectLoops {
+  template<int DIM>
+  static long long apply(const Rect<DIM> &rect)
+  {
+    long long sum = 0;
+    for_each_point(rect, [&sum](const Point<DIM> &p) {
+        for (int i = 0; i < DIM; i++)
+          sum += (i + 1) * p[i];
+      });
+    return sum;
+  }
+};
+
+template<typename F>
+double time_kernel(F kernel, const Domain &domain, int reps, long long &sum)
+{
+  const double start = Realm::Clock::current_time_in_nanoseconds();
+  for (int r = 0; r < reps; r++)
+    sum = kernel(domain);
+  return (Realm::Clock::current_time_in_nanoseconds() - start) / ((double)reps * domain.get_volume());
+}
+
+void run_domain(const Domain &domain, int reps)
+{
+  long long domain_sum, iterator_sum, loops_sum;
+  const double domain_ns = time_kernel(sum_domain_points, domain, reps, domain_sum);
+  const double iterator_ns = time_kernel([](const Domain &d) { return dispatch_dim<SumRectIterator>(d); },
+                                         domain, reps, iterator_sum);
+  const double loops_ns = time_kernel([](const Domain &d) { return dispatch_dim<SumRectLoops>(d); },
+                                      domain, reps, loops_sum);
+  assert(domain_sum == iterator_sum);
+  assert(domain_sum == loops_sum);
+  printf("%dD, %10zu points: DomainPointIterator %8.3f ns  PointInRectIterator %8.3f ns  "
+         "unrolled loops %8.3f ns per point\n",
+         domain.get_dim(), domain.get_volume(), domain_ns, iterator_ns, loops_ns);
+}
+
+//
+// Compares the cost per point of visiting 1D, 2D and 3D domains with about the same
+// number of points.
+//
+//  Command line options:
+//    -n N      approximate number of points in each domain
+//    -reps N   number of times each kernel visits each domain
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  long long n = 1 << 20;
+  int reps = 5;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-n") && (i+1) < command_args.argc)
+        n = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-reps") && (i+1) < command_args.argc)
+        reps = atoi(command_args.argv[++i]);
+    }
+
+  const coord_t side2 = (coord_t)sqrt((double)n);
+  const coord_t side3 = (coord_t)cbrt((double)n);
+  run_domain(Domain(Rect<1>(0, n - 1)), reps);
+  run_domain(Domain(Rect<2>(Point<2>(0,0), Point<2>(side2 - 1, side2 - 1))), reps);
+  run_domain(Domain(Rect<3>(Point<3>(0,0,0), Point<3>(side3 - 1, side3 - 1, side3 - 1))), reps);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
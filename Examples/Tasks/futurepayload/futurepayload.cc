@@ -0,0 +1,317 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+#include "default_mapper.h"
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  SERIALIZED_PRODUCER_ID,
+  DEFERRED_PRODUCER_ID,
+  SERIALIZED_CONSUMER_ID,
+  BUFFER_CONSUMER_ID,
+};
+
+// Consumers launched with this tag run in a different address space from the top-level
+// task; it is kept above the low bits of the tag, which the default mapper reads as flags
+static const MappingTagID REMOTE_TAG = 1 << 16;
+
+//
+// Every payload starts with the time at which the producer returned it, followed by
+// bytes holding their offset modulo 256.  The consumer subtracts the time stamp from
+// the time at which it can first read the payload.
+//
+void fill_payload(char *bytes, size_t size)
+{
+  for (size_t i = sizeof(double); i < size; i++)
+    bytes[i] = (char)i;
+  const double stamp = Realm::Clock::current_time_in_microseconds();
+  memcpy(bytes, &stamp, sizeof(stamp));
+}
+
+double read_payload(const char *bytes, size_t size)
+{
+  const double now = Realm::Clock::current_time_in_microseconds();
+  double stamp;
+  memcpy(&stamp, bytes, sizeof(stamp));
+  assert((size <= sizeof(double)) || (bytes[size - 1] == (char)(size - 1)));
+  return now - stamp;
+}
+
+//
+// A variable-size task result.  Legion serializes any return type that provides these
+// three methods, and get_result deserializes it into a new object, so the payload is
+// copied when the task returns and again when it is read.
+//
+struct Payload {
+  std::vector<char> bytes;
+
+  size_t legion_buffer_size(void) const
+  {
+    return sizeof(size_t) + bytes.size();
+  }
+  void legion_serialize(void *buffer) const
+  {
+    const size_t size = bytes.size();
+    memcpy(buffer, &size, sizeof(size));
+    memcpy((char *)buffer + sizeof(size), bytes.data(), size);
+  }
+  void legion_deserialize(const void *buffer)
+  {
+    size_t size;
+    memcpy(&size, buffer, sizeof(size));
+    const char *data = (const char *)buffer + sizeof(size);
+    bytes.assign(data, data + size);
+  }
+};
+
+//
+// Places consumers tagged with REMOTE_TAG on a processor of the same kind in another
+// address space, when there is one.
+//
+class PayloadMapper : public DefaultMapper {
+public:
+  PayloadMapper(MapperRuntime *rt, Machine m, Processor p);
+public:
+  virtual void select_task_options(const MapperContext ctx,
+                                   const Task &task,
+                                   TaskOptions &output);
+public:
+  static void register_payload_mappers(Machine machine, Runtime *rt,
+                                       const std::set<Processor> &local_procs);
+protected:
+  Processor remote_proc;
+};
+
+PayloadMapper::PayloadMapper(MapperRuntime *rt, Machine m, Processor p)
+  : DefaultMapper(rt, m, p, "payload_mapper")
+{
+  Machine::ProcessorQuery procs(m);
+  procs.only_kind(p.kind());
+  for (Machine::ProcessorQuery::iterator it = procs.begin(); it != procs.end(); it++)
+    if (it->address_space() != p.address_space())
+      {
+        remote_proc = *it;
+        break;
+      }
+}
+
+void PayloadMapper::select_task_options(const MapperContext ctx,
+                                        const Task &task,
+                                        TaskOptions &output)
+{
+  DefaultMapper::select_task_options(ctx, task, output);
+  if ((task.tag & REMOTE_TAG) && remote_proc.exists())
+    output.initial_proc = remote_proc;
+}
+
+/*static*/
+void PayloadMapper::register_payload_mappers(Machine machine, Runtime *rt,
+                                             const std::set<Processor> &local_procs)
+{
+  MapperRuntime *const map_rt = rt->get_mapper_runtime();
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+       it != local_procs.end(); it++)
+    {
+      rt->replace_default_mapper(new PayloadMapper(map_rt, machine, *it), *it);
+    }
+}
+
+// Average time in microseconds from a producer returning its payload to a consumer reading it,
+// measured with the clock of the one process that runs both tasks
+double run_pair(Context ctx, Runtime *runtime, TaskID producer_id, TaskID consumer_id,
+                size_t size, int trials)
+{
+  double total = 0;
+  for (int t = 0; t < trials; t++)
+    {
+      TaskLauncher producer_launcher(producer_id, TaskArgument(&size,sizeof(size)));
+      Future payload = runtime->execute_task(ctx, producer_launcher);
+      TaskLauncher consumer_launcher(consumer_id, TaskArgument(&size,sizeof(size)));
+      consumer_launcher.add_future(payload);
+      total += runtime->execute_task(ctx, consumer_launcher).get_result<double>();
+    }
+  return total / trials;
+}
+
+//
+// Average time in microseconds from launching a producer to receiving the result of its
+// consumer, measured by the parent.  The producer and consumer of a remote pair run in
+// different processes whose clocks need not agree, so only the parent's clock is used.
+//
+double round_trip(Context ctx, Runtime *runtime, TaskID producer_id, TaskID consumer_id,
+                  size_t size, bool remote, int trials)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  for (int t = 0; t < trials; t++)
+    {
+      TaskLauncher producer_launcher(producer_id, TaskArgument(&size,sizeof(size)));
+      Future payload = runtime->execute_task(ctx, producer_launcher);
+      TaskLauncher consumer_launcher(consumer_id, TaskArgument(&size,sizeof(size)));
+      consumer_launcher.add_future(payload);
+      if (remote)
+        consumer_launcher.tag = REMOTE_TAG;
+      runtime->execute_task(ctx, consumer_launcher).get_result<double>();
+    }
+  return (Realm::Clock::current_time_in_microseconds() - start) / trials;
+}
+
+//
+// Measures the latency of passing futures of increasing size from a producer task to
+// a consumer task, with the payload either returned as a serialized object and read
+// with get_result, or returned in an UntypedDeferredValue and read in place with
+// get_buffer.  When the machine has more than one address space the consumers are
+// also run in an address space other than the producer's.  The time stamps of two
+// processes are not comparable, so the +remote row is the round trip of a remote pair
+// as timed by the top-level task less that of a local pair with the same payload: the
+// extra cost of the consumer being in another process.
+//
+//  Command line options:
+//    -max BYTES   largest payload (the sizes used are 8 B, 4 KB, 1 MB and 64 MB, up to BYTES)
+//    -trials N    number of producer/consumer pairs per measurement
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  size_t max_size = 1 << 20;
+  int trials = 10;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_size = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-trials") && (i+1) < command_args.argc)
+        trials = atoi(command_args.argv[++i]);
+    }
+
+  bool has_remote = false;
+  Machine::ProcessorQuery procs(Machine::get_machine());
+  procs.only_kind(task->current_proc.kind());
+  for (Machine::ProcessorQuery::iterator it = procs.begin(); it != procs.end(); it++)
+    if (it->address_space() != task->current_proc.address_space())
+      has_remote = true;
+
+  const size_t sizes[] = { 8, 4 << 10, 1 << 20, 64 << 20 };
+  printf("%10s %-8s %16s %16s\n", "bytes", "consumer", "serialized us", "deferred us");
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+      if (sizes[s] > max_size)
+        break;
+      const double serialized_us = run_pair(ctx, runtime, SERIALIZED_PRODUCER_ID,
+                                            SERIALIZED_CONSUMER_ID, sizes[s], trials);
+      const double deferred_us = run_pair(ctx, runtime, DEFERRED_PRODUCER_ID,
+                                          BUFFER_CONSUMER_ID, sizes[s], trials);
+      printf("%10zu %-8s %16.3f %16.3f\n", sizes[s], "local", serialized_us, deferred_us);
+      if (has_remote)
+        {
+          const double serialized_local = round_trip(ctx, runtime, SERIALIZED_PRODUCER_ID,
+                                                     SERIALIZED_CONSUMER_ID, sizes[s], false, trials);
+          const double deferred_local = round_trip(ctx, runtime, DEFERRED_PRODUCER_ID,
+                                                   BUFFER_CONSUMER_ID, sizes[s], false, trials);
+          const double serialized_remote = round_trip(ctx, runtime, SERIALIZED_PRODUCER_ID,
+                                                      SERIALIZED_CONSUMER_ID, sizes[s], true, trials);
+          const double deferred_remote = round_trip(ctx, runtime, DEFERRED_PRODUCER_ID,
+                                                    BUFFER_CONSUMER_ID, sizes[s], true, trials);
+          printf("%10zu %-8s %16.3f %16.3f\n", sizes[s], "+remote",
+                 serialized_remote - serialized_local, deferred_remote - deferred_local);
+        }
+    }
+}
+
+Payload serialized_producer(const Task *task,
+			    const std::vector<PhysicalRegion> &regions,
+			    Context ctx,
+			    Runtime *runtime)
+{
+  const size_t size = *((const size_t *)task->args);
+  Payload payload;
+  payload.bytes.resize(size);
+  fill_payload(payload.bytes.data(), size);
+  return payload;
+}
+
+//
+// Write the payload straight into a buffer that becomes the future's data when the
+// task finalizes it, so the runtime has nothing to copy.  finalize must be the last
+// thing the task does.
+//
+void deferred_producer(const Task *task,
+		       const std::vector<PhysicalRegion> &regions,
+		       Context ctx,
+		       Runtime *runtime)
+{
+  const size_t size = *((const size_t *)task->args);
+  UntypedDeferredValue value(size, Memory::SYSTEM_MEM);
+  char *bytes = (char *)value.get_instance().pointer_untyped(0, size);
+  fill_payload(bytes, size);
+  value.finalize(ctx);
+}
+
+double serialized_consumer(const Task *task,
+			   const std::vector<PhysicalRegion> &regions,
+			   Context ctx,
+			   Runtime *runtime)
+{
+  const size_t size = *((const size_t *)task->args);
+  const Payload payload = task->futures[0].get_result<Payload>();
+  assert(payload.bytes.size() == size);
+  return read_payload(payload.bytes.data(), size);
+}
+
+// Read the payload where the runtime placed it in system memory, without copying it
+double buffer_consumer(const Task *task,
+		       const std::vector<PhysicalRegion> &regions,
+		       Context ctx,
+		       Runtime *runtime)
+{
+  const size_t size = *((const size_t *)task->args);
+  size_t extent = 0;
+  const char *bytes = (const char *)task->futures[0].get_buffer(Memory::SYSTEM_MEM, &extent);
+  assert(extent == size);
+  return read_payload(bytes, size);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SERIALIZED_PRODUCER_ID, "serialized_producer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<Payload,serialized_producer>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(DEFERRED_PRODUCER_ID, "deferred_producer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<deferred_producer>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(SERIALIZED_CONSUMER_ID, "serialized_consumer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,serialized_consumer>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(BUFFER_CONSUMER_ID, "buffer_consumer");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,buffer_consumer>(registrar);
+  }
+  Runtime::add_registration_callback(PayloadMapper::register_payload_mappers);
+
+  return Runtime::start(argc, argv);
+}
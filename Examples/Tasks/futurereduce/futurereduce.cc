@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  STEP_TASK_ID,
+};
+
+// The global sum the step tasks should receive, if they receive one through their arguments
+struct StepArgs {
+  double expected;
+  double global;
+  bool has_global;
+};
+
+IndexLauncher step_launcher(const Rect<1> &launch_domain, const StepArgs &args)
+{
+  ArgumentMap arg_map;
+  return IndexLauncher(STEP_TASK_ID, launch_domain, TaskArgument(&args,sizeof(args)), arg_map);
+}
+
+// Sum a FutureMap by waiting on each point in turn
+double sum_by_loop(const FutureMap &fm, const Rect<1> &launch_domain)
+{
+  double sum = 0;
+  for (PointInRectIterator<1> itr(launch_domain); itr(); itr++)
+    sum += fm.get_result<double>(*itr);
+  return sum;
+}
+
+//
+// The time to reduce the results of one index launch to a single value in the parent
+// task three ways: a loop calling get_result on every point of the FutureMap, the
+// runtime's reduce_future_map, and a reduction in the index launch itself.
+//
+void run_reduce(Context ctx, Runtime *runtime, const Rect<1> &launch_domain, double expected)
+{
+  StepArgs args;
+  args.expected = 0;
+  args.has_global = false;
+
+  double start = Realm::Clock::current_time_in_microseconds();
+  FutureMap fm = runtime->execute_index_space(ctx, step_launcher(launch_domain, args));
+  const double loop_sum = sum_by_loop(fm, launch_domain);
+  const double loop_us = Realm::Clock::current_time_in_microseconds() - start;
+
+  start = Realm::Clock::current_time_in_microseconds();
+  fm = runtime->execute_index_space(ctx, step_launcher(launch_domain, args));
+  const double map_sum =
+    runtime->reduce_future_map(ctx, fm, LEGION_REDOP_SUM_FLOAT64).get_result<double>();
+  const double map_us = Realm::Clock::current_time_in_microseconds() - start;
+
+  start = Realm::Clock::current_time_in_microseconds();
+  const double launch_sum = runtime->execute_index_space(ctx, step_launcher(launch_domain, args),
+                                                         LEGION_REDOP_SUM_FLOAT64).get_result<double>();
+  const double launch_us = Realm::Clock::current_time_in_microseconds() - start;
+
+  assert(loop_sum == expected);
+  assert(map_sum == expected);
+  assert(launch_sum == expected);
+  printf("%10zu points, reduce:     loop %10.3f ms  reduce_future_map %10.3f ms  launch %10.3f ms\n",
+         launch_domain.volume(), loop_us * 1e-3, map_us * 1e-3, launch_us * 1e-3);
+}
+
+//
+// An all-reduce: every iteration's index launch needs the global sum of the previous
+// iteration's results, as in the dot products of a Krylov solver.  The blocking version
+// reduces in the parent with a loop of get_result calls and passes the sum by value;
+// the non-blocking version passes the future from reduce_future_map to every point of
+// the next launch, so the parent never waits.
+//
+void run_allreduce(Context ctx, Runtime *runtime, const Rect<1> &launch_domain, double expected,
+                   int iterations)
+{
+  StepArgs args;
+  args.expected = expected;
+
+  runtime->issue_execution_fence(ctx).get_void_result();
+  double start = Realm::Clock::current_time_in_microseconds();
+  args.has_global = false;
+  FutureMap fm = runtime->execute_index_space(ctx, step_launcher(launch_domain, args));
+  for (int i = 0; i < iterations; i++)
+    {
+      args.global = sum_by_loop(fm, launch_domain);
+      args.has_global = true;
+      fm = runtime->execute_index_space(ctx, step_launcher(launch_domain, args));
+    }
+  fm.wait_all_results();
+  const double loop_us = Realm::Clock::current_time_in_microseconds() - start;
+
+  start = Realm::Clock::current_time_in_microseconds();
+  args.has_global = false;
+  fm = runtime->execute_index_space(ctx, step_launcher(launch_domain, args));
+  for (int i = 0; i < iterations; i++)
+    {
+      Future global = runtime->reduce_future_map(ctx, fm, LEGION_REDOP_SUM_FLOAT64);
+      IndexLauncher launcher = step_launcher(launch_domain, args);
+      launcher.add_future(global);
+      fm = runtime->execute_index_space(ctx, launcher);
+    }
+  fm.wait_all_results();
+  const double future_us = Realm::Clock::current_time_in_microseconds() - start;
+
+  printf("%10zu points, all-reduce: loop %10.3f ms  reduce_future_map %10.3f ms  (per iteration)\n",
+         launch_domain.volume(), loop_us * 1e-3 / iterations, future_us * 1e-3 / iterations);
+}
+
+//
+//  Command line options:
+//    -max N          largest number of points (the counts used are 1000, 10000, ... up to N)
+//    -iterations N   number of all-reduce iterations
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  long long max_points = 10000;
+  int iterations = 5;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-max") && (i+1) < command_args.argc)
+        max_points = atoll(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-iterations") && (i+1) < command_args.argc)
+        iterations = atoi(command_args.argv[++i]);
+    }
+
+  for (long long points = 1000; points <= max_points; points *= 10)
+    {
+      const Rect<1> launch_domain(1,points);
+      // Point i contributes i, so the sum is exact in double precision
+      const double expected = 0.5 * points * (points + 1);
+      run_reduce(ctx, runtime, launch_domain, expected);
+      run_allreduce(ctx, runtime, launch_domain, expected, iterations);
+    }
+}
+
+double step_task(const Task *task,
+		 const std::vector<PhysicalRegion> &regions,
+		 Context ctx,
+		 Runtime *runtime)
+{
+  const StepArgs &args = *((const StepArgs *)task->args);
+  if (!task->futures.empty())
+    assert(task->futures[0].get_result<double>() == args.expected);
+  else if (args.has_global)
+    assert(args.global == args.expected);
+  return task->index_point[0];
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(STEP_TASK_ID, "step_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<double,step_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
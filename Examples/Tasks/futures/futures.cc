@@ -53,16 +53,19 @@ int main(int argc, char **argv)
   {
     TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<top_level_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(SUBTASK_PRODUCER_ID, "subtask_producer");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<int,subtask_producer>(registrar);
   }
   {
     TaskVariantRegistrar registrar(SUBTASK_CONSUMER_ID, "subtask_consumer");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
     Runtime::preregister_task_variant<subtask_consumer>(registrar);
   }
   return Runtime::start(argc, argv);
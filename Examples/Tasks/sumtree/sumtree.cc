@@ -89,11 +89,13 @@ int main(int argc, char **argv)
   {
     TaskVariantRegistrar registrar(SUM_ID, "sum");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<sum_task>(registrar);
   }
   {
     TaskVariantRegistrar registrar(SUM_TREE_ID, "sum_tree");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
     Runtime::preregister_task_variant<int,sum_tree_task>(registrar);
   }
   return Runtime::start(argc, argv);
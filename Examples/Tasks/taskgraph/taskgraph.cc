@@ -0,0 +1,195 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include "legion.h"
+
+using namespace Legion;
+
+// All tasks must have a unique task id (a small integer).
+// A global enum is a convenient way to assign task ids.
+enum TaskID {
+  TOP_LEVEL_TASK_ID,
+  NODE_TASK_ID,
+};
+
+// Each node returns its depth in the graph, one more than the deepest of its inputs,
+// and how long it ran
+struct NodeResult {
+  int depth;
+  double busy_us;
+};
+
+struct GraphStats {
+  std::vector<Future> nodes;
+  int critical_path;
+};
+
+Future launch_node(Context ctx, Runtime *runtime, const std::vector<Future> &inputs, double work_us)
+{
+  TaskLauncher node_launcher(NODE_TASK_ID, TaskArgument(&work_us,sizeof(work_us)));
+  for (unsigned i = 0; i < inputs.size(); i++)
+    node_launcher.add_future(inputs[i]);
+  return runtime->execute_task(ctx, node_launcher);
+}
+
+// A chain of depth nodes, each depending on the one before it
+void build_chain(Context ctx, Runtime *runtime, int depth, int width, double work_us,
+                 GraphStats &graph)
+{
+  std::vector<Future> inputs;
+  for (int d = 0; d < depth; d++)
+    {
+      Future node = launch_node(ctx, runtime, inputs, work_us);
+      graph.nodes.push_back(node);
+      inputs.assign(1, node);
+    }
+  graph.critical_path = depth;
+}
+
+// depth stages, each fanning out from one node to width nodes and back in to one node
+void build_fan(Context ctx, Runtime *runtime, int depth, int width, double work_us,
+               GraphStats &graph)
+{
+  Future root = launch_node(ctx, runtime, std::vector<Future>(), work_us);
+  graph.nodes.push_back(root);
+  for (int d = 0; d < depth; d++)
+    {
+      std::vector<Future> fan;
+      for (int w = 0; w < width; w++)
+        fan.push_back(launch_node(ctx, runtime, std::vector<Future>(1, root), work_us));
+      graph.nodes.insert(graph.nodes.end(), fan.begin(), fan.end());
+      root = launch_node(ctx, runtime, fan, work_us);
+      graph.nodes.push_back(root);
+    }
+  graph.critical_path = 1 + 2 * depth;
+}
+
+// depth levels of width nodes, each depending on two neighbouring nodes of the level above
+void build_lattice(Context ctx, Runtime *runtime, int depth, int width, double work_us,
+                   GraphStats &graph)
+{
+  std::vector<Future> level;
+  for (int w = 0; w < width; w++)
+    level.push_back(launch_node(ctx, runtime, std::vector<Future>(), work_us));
+  graph.nodes.insert(graph.nodes.end(), level.begin(), level.end());
+  for (int d = 1; d < depth; d++)
+    {
+      std::vector<Future> next;
+      for (int w = 0; w < width; w++)
+        {
+          std::vector<Future> inputs;
+          inputs.push_back(level[w]);
+          if (width > 1)
+            inputs.push_back(level[(w + 1) % width]);
+          next.push_back(launch_node(ctx, runtime, inputs, work_us));
+        }
+      graph.nodes.insert(graph.nodes.end(), next.begin(), next.end());
+      level.swap(next);
+    }
+  graph.critical_path = depth;
+}
+
+typedef void (*GraphBuilder)(Context, Runtime *, int, int, double, GraphStats &);
+
+void run_graph(Context ctx, Runtime *runtime, const char *name, GraphBuilder builder,
+               int depth, int width, double work_us)
+{
+  runtime->issue_execution_fence(ctx).get_void_result();
+  GraphStats graph;
+  const double start = Realm::Clock::current_time_in_microseconds();
+  builder(ctx, runtime, depth, width, work_us, graph);
+  runtime->issue_execution_fence(ctx).get_void_result();
+  const double elapsed = Realm::Clock::current_time_in_microseconds() - start;
+
+  double busy = 0;
+  int deepest = 0;
+  for (unsigned i = 0; i < graph.nodes.size(); i++)
+    {
+      const NodeResult result = graph.nodes[i].get_result<NodeResult>();
+      busy += result.busy_us;
+      if (result.depth > deepest)
+        deepest = result.depth;
+    }
+  assert(deepest == graph.critical_path);
+  // The longest path has critical_path nodes, each working for work_us, joined by
+  // critical_path - 1 edges; what remains of the time is the latency of the edges
+  const int edges = graph.critical_path - 1;
+  const double edge_us = (edges > 0) ? (elapsed - graph.critical_path * work_us) / edges : 0;
+  printf("%-8s %8zu tasks %6d deep: %10.3f us per edge, parallelism %6.2f\n",
+         name, graph.nodes.size(), graph.critical_path, edge_us, busy / elapsed);
+}
+
+//
+// Builds graphs of trivial tasks connected only by futures and measures the latency
+// of each dependency edge on the critical path (the total time, less the work of the
+// tasks on the longest path, divided by the number of edges of that path) and the
+// parallelism achieved (the total time the tasks ran divided by the total time).
+//
+//  Command line options:
+//    -depth N   length of the chain, number of fan stages, or levels of the lattice
+//    -width N   width of the fans and of the lattice
+//    -work US   time each task spends working
+//
+void top_level_task(const Task *task,
+		    const std::vector<PhysicalRegion> &regions,
+		    Context ctx,
+		    Runtime *runtime)
+{
+  int depth = 100;
+  int width = 8;
+  double work_us = 10;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+    {
+      if (!strcmp(command_args.argv[i], "-depth") && (i+1) < command_args.argc)
+        depth = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-width") && (i+1) < command_args.argc)
+        width = atoi(command_args.argv[++i]);
+      else if (!strcmp(command_args.argv[i], "-work") && (i+1) < command_args.argc)
+        work_us = atof(command_args.argv[++i]);
+    }
+  assert((depth > 0) && (width > 0));
+
+  run_graph(ctx, runtime, "chain", build_chain, depth, width, work_us);
+  run_graph(ctx, runtime, "fan", build_fan, depth, width, work_us);
+  run_graph(ctx, runtime, "lattice", build_lattice, depth, width, work_us);
+}
+
+NodeResult node_task(const Task *task,
+		     const std::vector<PhysicalRegion> &regions,
+		     Context ctx,
+		     Runtime *runtime)
+{
+  const double start = Realm::Clock::current_time_in_microseconds();
+  NodeResult result;
+  result.depth = 0;
+  for (unsigned i = 0; i < task->futures.size(); i++)
+    {
+      const int depth = task->futures[i].get_result<NodeResult>().depth;
+      if (depth > result.depth)
+        result.depth = depth;
+    }
+  result.depth++;
+  const double work_us = *((const double *)task->args);
+  while (Realm::Clock::current_time_in_microseconds() < start + work_us) ;
+  result.busy_us = Realm::Clock::current_time_in_microseconds() - start;
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_inner();
+    Runtime::preregister_task_variant<top_level_task>(registrar);
+  }
+  {
+    TaskVariantRegistrar registrar(NODE_TASK_ID, "node_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<NodeResult,node_task>(registrar);
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+
+#
+# Runs one performance test: an example executable is run a few times, the best value
+# of its measured region is written to NAME.perf.json, and the test fails if that value
+# is more than the tolerance worse than the baseline recorded for NAME.  With
+# PERF_UPDATE=1 in the environment the value is recorded as the new baseline instead.
+#
+#   perf_test.py --name NAME --baselines FILE --metric REGEX [options] -- COMMAND...
+#
+# The examples time their own measured regions and print the results, so a run is
+# measured by the sum of every group of every match of REGEX in its output, which
+# leaves out the startup and shutdown of the runtime.  Use --higher-is-better for
+# throughputs.
+#
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+def run_once(command, metric):
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = result.stdout.decode(encoding='utf-8', errors='replace')
+    if result.returncode != 0:
+        sys.stdout.write(output)
+        raise Exception('%s exited with status %d' % (command[0], result.returncode))
+    values = [float(group) for match in re.finditer(metric, output, re.MULTILINE)
+              for group in match.groups() if group is not None]
+    if not values:
+        sys.stdout.write(output)
+        raise Exception('%s printed nothing that matches %r' % (command[0], metric))
+    return sum(values)
+
+def load_baselines(path):
+    if not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        return json.load(f)
+
+def save_baselines(path, baselines):
+    with open(path, 'w') as f:
+        json.dump(baselines, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+def main():
+    argv = sys.argv[1:]
+    if '--' not in argv:
+        sys.exit('usage: perf_test.py --name NAME --baselines FILE --metric REGEX [options] -- COMMAND...')
+    split = argv.index('--')
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--name', required=True)
+    parser.add_argument('--baselines', required=True)
+    parser.add_argument('--metric', required=True,
+                        help='regular expression whose groups are the measured values')
+    parser.add_argument('--unit', default='',
+                        help='unit of the measured values, for the messages')
+    parser.add_argument('--higher-is-better', action='store_true',
+                        help='the values are throughputs rather than times')
+    parser.add_argument('--tolerance', type=float, default=0.25,
+                        help='allowed slowdown relative to the baseline (0.25 is 25%%)')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='number of runs; the best value is used')
+    args = parser.parse_args(argv[:split])
+    command = argv[split+1:]
+
+    runs = [run_once(command, args.metric) for _ in range(args.repeat)]
+    value = max(runs) if args.higher_is_better else min(runs)
+    with open('%s.perf.json' % args.name, 'w') as f:
+        json.dump({'name': args.name, 'command': command, 'metric': args.metric,
+                   'unit': args.unit, 'higher_is_better': args.higher_is_better,
+                   'value': value, 'runs': runs},
+                  f, indent=2)
+        f.write('\n')
+
+    baselines = load_baselines(args.baselines)
+    if os.environ.get('PERF_UPDATE'):
+        # Keep any tolerance recorded for the test with its new baseline
+        baselines.setdefault(args.name, {})['value'] = round(value, 3)
+        save_baselines(args.baselines, baselines)
+        print('%s: recorded a baseline of %.3f %s' % (args.name, value, args.unit))
+        return 0
+    if args.name not in baselines:
+        print('%s: %.3f %s; no baseline recorded' % (args.name, value, args.unit))
+        return 0
+    baseline = baselines[args.name]['value']
+    # A baseline can carry its own tolerance for tests that are noisier than most
+    tolerance = baselines[args.name].get('tolerance', args.tolerance)
+    # The margin is relative to the size of the baseline, since some values (such as
+    # taskgraph's latency per edge) can be zero or negative
+    margin = tolerance * abs(baseline)
+    if args.higher_is_better:
+        limit = baseline - margin
+        regressed = value < limit
+    else:
+        limit = baseline + margin
+        regressed = value > limit
+    print('%s: %.3f %s, baseline %.3f %s, limit %.3f %s' %
+          (args.name, value, args.unit, baseline, args.unit, limit, args.unit))
+    if regressed:
+        if baseline != 0:
+            print('%s: regression of %.1f%%' %
+                  (args.name, 100 * abs(value - baseline) / abs(baseline)))
+        else:
+            print('%s: regression from a baseline of 0' % args.name)
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -11,4 +11,7 @@ fi
 
 if [[ -n $TEST_CXX ]]; then
     docker build --build-arg LEGION_BRANCH=$LEGION_BRANCH -f docker/Dockerfile.cxx -t build .
+    tmp=$(docker create build)
+    docker cp $tmp:/build/Examples/build/traces .
+    docker rm $tmp
 fi
@@ -21,7 +21,18 @@ popd
 # Build Examples
 mkdir -p Examples/build
 pushd Examples/build
-cmake -DCMAKE_PREFIX_PATH="$PWD"/../../legion/install ..
+perf=OFF
+if [[ -n $PERF_TESTS ]]; then
+    perf=ON
+fi
+cmake -DCMAKE_PREFIX_PATH="$PWD"/../../legion/install -DLEGION_EXAMPLES_PERF=$perf ..
 make -j${THREADS:-2}
-ctest --output-on-failure -j${THREADS:-2}
+ctest --output-on-failure -j${THREADS:-2} -LE perf
+# The performance tests run one at a time so that they do not disturb each other
+if [[ -n $PERF_TESTS ]]; then
+    ctest --output-on-failure -L perf
+fi
+# Collect the task traces written by the tests run with -trace
+mkdir -p traces
+find . -path ./traces -prune -o -name '*.trace.json*' -exec cp {} traces/ \;
 popd